@@ -57,9 +57,15 @@ U8 db_tilt_flag;
 void db_dump_all (void)
 {
 	VOIDCALL (task_dump);
+#ifdef CONFIG_TASK_PROFILE
+	VOIDCALL (task_profile_dump);
+#endif
 	VOIDCALL (dump_game);
 	VOIDCALL (dump_deffs);
 	switch_queue_dump ();
+#ifdef CONFIG_SWITCH_LATENCY
+	switch_latency_dump ();
+#endif
 	VOIDCALL (triac_dump);
 	SECTION_VOIDCALL (__common__, device_debug_all);
 }
@@ -54,6 +54,7 @@ __attribute__((noinline)) void dmd_rough_copy1 (void)
 		dmd_rough_args.dst += DMD_BYTE_WIDTH;
 		dmd_rough_args.size.y--;
 	} while (dmd_rough_args.size.y > 0);
+	dmd_dirty_untracked ();
 }
 
 
@@ -77,6 +78,7 @@ __attribute__((noinline)) void dmd_rough_erase1 (void)
 		dmd_rough_args.dst += DMD_BYTE_WIDTH;
 		dmd_rough_args.size.y--;
 	} while (dmd_rough_args.size.y > 0);
+	dmd_dirty_untracked ();
 }
 
 
@@ -100,6 +102,7 @@ __attribute__((noinline)) void dmd_rough_invert1 (void)
 		dmd_rough_args.dst += DMD_BYTE_WIDTH;
 		dmd_rough_args.size.y--;
 	} while (dmd_rough_args.size.y > 0);
+	dmd_dirty_untracked ();
 }
 
 
@@ -113,6 +116,7 @@ void dmd_row_copy (U8 *dst)
 	((U16 *)dst)[1] = src[1];
 	((U16 *)dst)[2] = src[2];
 	((U16 *)dst)[3] = src[3];
+	dmd_dirty_untracked ();
 }
 
 
@@ -132,4 +136,5 @@ void dmd_column_copy (U8 *dst)
 		src += 4 * DMD_BYTE_WIDTH;
 		count--;
 	} while (count != 0);
+	dmd_dirty_untracked ();
 }
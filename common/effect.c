@@ -108,6 +108,7 @@ void dmd_draw_border (U8 *dbuf)
 	register U16 *dbuf16_bot = (U16 *)dbuf_bot;
 	U8 i;
 
+	dmd_dirty_rows (dbuf, 0, PINIO_DMD_HEIGHT);
 	for (i=0; i < 16; i++)
 		*dbuf16_bot++ = *dbuf16++ = 0xFFFFUL;
 	dbuf += 32;
@@ -127,6 +128,7 @@ void dmd_draw_thin_border (U8 *dbuf)
 	register U16 *dbuf16_bot = (U16 *)dbuf_bot;
 	U8 i;
 
+	dmd_dirty_rows (dbuf, 0, PINIO_DMD_HEIGHT);
 	for (i=0; i < 8; i++)
 		*dbuf16_bot++ = *dbuf16++ = 0xFFFFUL;
 	dbuf += 16;
@@ -144,6 +146,7 @@ void dmd_draw_thin_border (U8 *dbuf)
  */
 void dmd_draw_horiz_line (U16 *dbuf, U8 y)
 {
+	dmd_dirty_rows ((const U8 *)dbuf, y, 1);
 	dbuf += y * (16 / 2);
 
 	*dbuf++ = 0xffffUL;
@@ -208,6 +208,30 @@ void high_score_reset (void)
 }
 
 
+#ifdef CONFIG_NATIVE
+/** Write the high score table to a simulator report file, one entry
+ * per line, grand champion first.  The BCD score is written as plain
+ * decimal digits. */
+void high_score_write_report (FILE *fp)
+{
+	U8 place;
+	U8 n;
+	struct high_score *hs;
+
+	for (place=0; place < HS_COUNT; place++)
+	{
+		hs = &high_score_table[place];
+		fprintf (fp, "HS%d\t", place);
+		for (n=0; n < HIGH_SCORE_WIDTH - 1 && hs->score[n] == 0; n++);
+		fprintf (fp, "%X", hs->score[n]);
+		for (n++; n < HIGH_SCORE_WIDTH; n++)
+			fprintf (fp, "%02X", hs->score[n]);
+		fprintf (fp, "\t%.*s\n", HIGH_SCORE_NAMESZ, hs->initials);
+	}
+}
+#endif
+
+
 void hsentry_deff (void)
 {
 	dmd_alloc_low_clean ();
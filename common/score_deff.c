@@ -30,6 +30,18 @@
 /** Nonzero if the current score has changed and needs to be redrawn */
 bool score_update_needed;
 
+/** The scores as they were last drawn by the score screen */
+score_t scores_drawn[MAX_PLAYERS];
+
+/** Nonzero if scores_drawn[] matches what is on the score screen */
+bool scores_drawn_valid;
+
+/** The status bar value (ball number or game timer) last drawn */
+U8 scores_drawn_status;
+
+/** The player up when the score screen was last drawn */
+U8 scores_drawn_player_up;
+
 
 /** Draw the current ball number at the bottom of the display. */
 void scores_draw_status_bar (void)
@@ -91,6 +103,67 @@ void scores_draw_current (U8 skip_player)
 }
 
 
+/** Return the value that the status bar is drawn from.  If this
+changes, the whole score screen needs to be redrawn. */
+static U8 scores_status_key (void)
+{
+	if (config_timed_game)
+		return timed_game_timer;
+	else
+		return ball_up;
+}
+
+
+/** Note that the score screen has just been drawn in full, so that
+later updates can be limited to the scores that change. */
+void scores_draw_cache_update (void)
+{
+	U8 p;
+
+	for (p=0; p < num_players; p++)
+		score_copy (scores_drawn[p], scores[p]);
+	scores_drawn_status = scores_status_key ();
+	scores_drawn_player_up = player_up;
+	scores_drawn_valid = TRUE;
+}
+
+
+/** Note that the score screen must be drawn in full on the next update. */
+void scores_draw_cache_invalidate (void)
+{
+	scores_drawn_valid = FALSE;
+}
+
+
+/**
+ * Redraw only the scores that have changed since the screen was last
+ * drawn in full.  Returns FALSE, without drawing anything, if that is
+ * not possible and the caller must redraw everything.
+ */
+bool scores_draw_changed (void)
+{
+	U8 p;
+
+	if (!scores_drawn_valid
+		|| scores_status_key () != scores_drawn_status
+		|| player_up != scores_drawn_player_up)
+		return FALSE;
+
+	for (p=0; p < num_players; p++)
+	{
+		if (score_compare (scores[p], scores_drawn[p]) == 0)
+			continue;
+
+		/* The low-level handler can still see the old value in
+		scores_drawn[] to work out what to erase. */
+		sprintf_score (scores[p]);
+		ll_scores_draw_changed (p);
+		score_copy (scores_drawn[p], scores[p]);
+	}
+	return TRUE;
+}
+
+
 /** Draw the entire score screen statically.  In this mode,
 no scores are flashing; everything is fixed. */
 void scores_draw (void)
@@ -108,6 +181,8 @@ flashing.  This is used when new players are added or
 at ball start. */
 void scores_important_deff (void)
 {
+	scores_draw_cache_invalidate ();
+	dmd_dirty_track_begin ();
 	dmd_alloc_low_clean ();
 	scores_draw ();
 	dmd_show_low ();
@@ -127,6 +202,16 @@ void scores_deff (void)
 	the main display effect starts. */
 	callset_invoke (score_deff_start);
 
+	/* Whatever ran before may have reused the score pages, so the
+	first update must redraw everything. */
+	scores_draw_cache_invalidate ();
+
+	/* The scores are drawn by functions that report the rows they
+	touch, so only those rows need to be cleared or copied on each
+	update.  The machine's score_overlay handlers do not report, so
+	the pages they draw on are treated as entirely dirty. */
+	dmd_dirty_track_begin ();
+
 	/* This effect always runs, until it is preempted. */
 	for (;;)
 	{
@@ -150,3 +235,12 @@ void scores_deff (void)
 	}
 }
 
+
+
+/** The score layout changes whenever the number of players or the
+player up changes, and when the playfield becomes valid; nothing that
+was drawn before can be reused. */
+CALLSET_ENTRY (score_deff, start_game, start_ball, start_player, add_player, valid_playfield, amode_start, stop_game)
+{
+	scores_draw_cache_invalidate ();
+}
@@ -168,6 +168,15 @@ U8 ll_sweep_overlay_needed;
 
 U8 ll_dmd_sweep_counter;
 
+/** The area covered by each player's score when it was last drawn */
+struct ll_score_box
+{
+	U8 x;
+	U8 y;
+	U8 width;
+	U8 height;
+} ll_score_boxes[MAX_PLAYERS];
+
 
 __attribute__((noinline)) void ll_score_change_player (void)
 {
@@ -190,6 +199,69 @@ void ll_scores_draw_current (U8 player)
 
 	/* Start printing to the display */
 	info->render (sprintf_buffer);
+
+	/* Remember where the string went.  Rendering leaves the x coordinate
+	one pixel past the right edge of the last character. */
+	ll_score_boxes[player].x = font_args.coord.x - font_string_width - 1;
+	ll_score_boxes[player].y = font_args.coord.y;
+	ll_score_boxes[player].width = font_string_width;
+	ll_score_boxes[player].height = info->font->height;
+}
+
+
+/* Clear the pixels covered by a previously drawn score.  Other scores
+can share the same rows, and even the same bytes at the edges, so
+the pixels outside the box are preserved. */
+static void ll_score_erase_box (const struct ll_score_box *box)
+{
+	U8 *dst;
+	U8 first, last;
+	U8 first_keep, last_keep;
+	U8 n;
+	U8 row;
+
+	first = box->x / 8;
+	last = (box->x + box->width - 1) / 8;
+	first_keep = (1 << (box->x & 7)) - 1;
+	last_keep = ((box->x + box->width) & 7) ? 0xFF << ((box->x + box->width) & 7) : 0;
+	if (first == last)
+		first_keep |= last_keep;
+
+	dst = dmd_low_buffer + (U16)box->y * DMD_BYTE_WIDTH + first;
+	for (row = 0; row < box->height; row++)
+	{
+		dst[0] &= first_keep;
+		for (n = 1; n < last - first; n++)
+			dst[n] = 0;
+		if (last != first)
+			dst[last - first] &= last_keep;
+		dst += DMD_BYTE_WIDTH;
+	}
+}
+
+
+/* Redraw a single score that has changed since the overlay was last
+drawn.  The old string is erased from the low page, the new one is
+rendered there, and the affected bytes are copied to the high page. */
+void ll_scores_draw_changed (U8 player)
+{
+	struct ll_score_box *box = &ll_score_boxes[player];
+	U8 x, end;
+
+	ll_score_erase_box (box);
+	x = box->x;
+	end = box->x + box->width;
+
+	ll_scores_draw_current (player);
+	if (box->x < x)
+		x = box->x;
+	if (box->x + box->width > end)
+		end = box->x + box->width;
+
+	x &= ~7;
+	end = (end + 7) & ~7;
+	dmd_rough_copy (x, box->y, end - x, box->height);
+	dmd_dirty_rows (dmd_high_buffer, box->y, box->height);
 }
 
 
@@ -242,16 +314,23 @@ void ll_score_redraw (void)
 {
 	if (valid_playfield)
 	{
+		/* The overlay pages persist between updates, so usually only
+		the scores that changed need to be redrawn there. */
 		dmd_map_overlay ();
-		dmd_clean_page_low ();
-		scores_draw_status_bar ();
-		scores_draw_current (SCORE_DRAW_ALL);
-		dmd_copy_low_to_high ();
+		if (!scores_draw_changed ())
+		{
+			dmd_clean_page_low ();
+			scores_draw_status_bar ();
+			scores_draw_current (SCORE_DRAW_ALL);
+			dmd_copy_low_to_high ();
+			scores_draw_cache_update ();
+		}
 		/* Take care that player_up != 0 */
 		ll_score_sweep_init ();
 	}
 	else
 	{
+		scores_draw_cache_invalidate ();
 		dmd_alloc_pair ();
 		dmd_clean_page_low ();
 		scores_draw_status_bar ();
@@ -293,6 +372,7 @@ void ll_score_strobe_valid (void)
 			pinio_dmd_window_set (PINIO_DMD_WINDOW_1, DMD_OVERLAY_PAGE);
 			memcpy (dmd_low_buffer + ll_dmd_sweep_addr,
 				dmd_high_buffer + ll_dmd_sweep_addr, ll_sweep_width);
+			dmd_dirty_rows (dmd_low_buffer, ll_dmd_sweep_addr / DMD_BYTE_WIDTH, 1);
 			pinio_dmd_window_set (PINIO_DMD_WINDOW_1,
 				pinio_dmd_window_get (PINIO_DMD_WINDOW_0) + 1);
 		}
@@ -306,6 +386,7 @@ void ll_score_strobe_valid (void)
 		{
 			ll_sweep_overlay_needed = LL_STROBE_OVERLAY_RATE;
 			callset_invoke (score_overlay);
+			dmd_dirty_untracked ();
 		}
 
 		/* Show the new frame */
@@ -341,12 +422,14 @@ void ll_score_strobe_valid (void)
 	dmd_dup_mapped ();
 	dmd_overlay_onto_color ();
 	callset_invoke (score_overlay);
+	dmd_dirty_untracked ();
 	dmd_show2 ();
 #else
 	dmd_map_overlay ();
 	dmd_dup_mapped ();
 	dmd_overlay ();
 	callset_invoke (score_overlay);
+	dmd_dirty_untracked ();
 	dmd_show_low ();
 #endif
 	score_deff_sleep (TIME_133MS);
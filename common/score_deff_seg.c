@@ -25,8 +25,67 @@ void ll_scores_draw_current (U8 single_player)
 	seg_write_string (0, 0, sprintf_buffer);
 }
 
+/* Write the part of a changed score that differs from what was
+drawn, to the current page.  Segment displays have fixed character
+cells, so when the new string is the same length as the old one, only
+the cells from the first differing digit onward are rewritten.
+Otherwise the score row is cleared and written again. */
+static void ll_scores_write_changed (const char *text, const char *old)
+{
+	U8 n, col;
+
+	n = col = 0;
+	if (strlen (text) == strlen (old))
+	{
+		while (text[n] != '\0' && text[n] == old[n])
+		{
+			if (text[n] != ',' && text[n] != '.')
+				col++;
+			n++;
+		}
+	}
+	else
+		seg_erase_row (0);
+	seg_write_string (0, col, text + n);
+}
+
+/* Redraw a single score that has changed since the pages were last
+drawn.  Every score is written to the same row, so each page shows
+the last score that ll_score_redraw() wrote to it: the last player's
+on the high page, and the last player's other than the player up on
+the low page.  Only the pages that show this player's score are
+updated, so the player up still flashes. */
+void ll_scores_draw_changed (U8 player)
+{
+	/* Room for every digit plus its separators */
+	char text[MACHINE_SCORE_DIGITS * 2];
+	U8 low_player;
+
+	strcpy (text, sprintf_buffer);
+	sprintf_score (scores_drawn[player]);
+
+	low_player = num_players - 1;
+	if (low_player + 1 == player_up && low_player > 0)
+		low_player--;
+
+	if (player == low_player)
+		ll_scores_write_changed (text, sprintf_buffer);
+	if (player == num_players - 1)
+	{
+		seg_flip_low_high ();
+		ll_scores_write_changed (text, sprintf_buffer);
+		seg_flip_low_high ();
+	}
+}
+
 void ll_score_redraw (void)
 {
+	if (scores_draw_changed ())
+	{
+		seg_show ();
+		return;
+	}
+
 	seg_alloc ();
 	seg_erase ();
 	scores_draw_status_bar ();
@@ -34,6 +93,7 @@ void ll_score_redraw (void)
 	seg_copy_low_to_high ();
 	scores_draw_current (player_up);
 	seg_show ();
+	scores_draw_cache_update ();
 }
 
 void ll_score_change_player (void)
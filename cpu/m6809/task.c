@@ -74,6 +74,66 @@ __fastram__ U16 task_save_U, task_save_X;
 /** The static array of task structures */
 task_t task_buffer[NUM_TASKS];
 
+/** The number of wakeup lists in the timer wheel.  This must be a
+ * power of 2. */
+#define TASK_WHEEL_SIZE 16
+
+/** The ready list holds tasks that can run now, in FIFO order.  The
+ * dispatcher only ever pulls tasks off the head of this list, so it never
+ * has to look at tasks that are still asleep. */
+task_t *task_ready_head;
+task_t *task_ready_tail;
+
+/** The timer wheel holds sleeping tasks.  A task is kept on the list
+ * selected by the low bits of its wakeup time.  Each time the system
+ * time advances by one tick, only that tick's list needs to be scanned.
+ * Tasks which sleep for longer than one turn of the wheel simply stay
+ * on their list until the right turn comes around. */
+task_t *task_wheel[TASK_WHEEL_SIZE];
+
+/** The system time up to which the timer wheel has been processed.  All
+ * tasks with a wakeup time earlier than this have been moved to the
+ * ready list. */
+U16 task_wheel_time;
+
+/** The number of chains in the group ID hash table.  This must be a
+ * power of 2. */
+#define TASK_GID_HASH_SIZE 16
+
+/** Every task is linked onto one of these chains, selected by the low
+ * bits of its group ID.  Group IDs are assigned sequentially, so tasks
+ * in different groups spread out evenly and a lookup only needs to
+ * examine a handful of tasks. */
+task_t *task_gid_hash[TASK_GID_HASH_SIZE];
+
+/** The number of group ID lookups made during the current tick. */
+U16 task_gid_lookups;
+
+/** The number of group ID lookups made during the previous tick, and the
+ * largest number seen in any one tick since the last reset. */
+U16 task_gid_lookups_last;
+U16 task_gid_lookups_max;
+
+#ifdef CONFIG_TASK_PROFILE
+/** The profile entries, one per group ID seen since the last reset.
+ * The last entry is reserved for groups that did not fit. */
+task_profile_t task_profile_table[TASK_PROFILE_SLOTS];
+
+/** The number of profile entries that have been assigned a group ID */
+U8 task_profile_count;
+
+/** A histogram of wakeup latencies for all tasks.  The buckets hold
+ * latencies of 0, 1, 2, 3-4, 5-8, and more than 8 ticks. */
+U16 task_profile_latency[TASK_PROFILE_LATENCY_BUCKETS];
+
+/** The number of IRQs that occurred when no task was running; that is,
+ * during the dispatcher, the periodic functions, and idle time. */
+U16 task_profile_idle_time;
+
+/** The profile entry for the running task, or NULL if none */
+task_profile_t *task_profile_current;
+#endif
+
 /** A flag that indicates that dispatching is working as expected.
  * This is set to 1 everytime we dispatch correctly, and to 0
  * periodically from the IRQ.  If the IRQ finds it at 0, that
@@ -207,6 +267,8 @@ void task_dump (void)
 #ifdef CONFIG_DEBUG_TASKCOUNT
 	dbprintf ("Max tasks = %d\n", task_max_count);
 #endif
+	dbprintf ("GID lookups/tick = %ld, max %ld\n",
+		task_gid_lookups_last, task_gid_lookups_max);
 	for (t=0, tp = task_buffer; tp < task_tail; t++, tp++)
 	{
 		if (tp->state != BLOCK_FREE)
@@ -341,6 +403,227 @@ void block_free (task_t *tp)
 }
 
 
+/** Append a task to the end of the ready list. */
+static inline void task_ready_add (task_t *tp)
+{
+	tp->next = NULL;
+	tp->prev = task_ready_tail;
+	if (task_ready_head)
+		task_ready_tail->next = tp;
+	else
+		task_ready_head = tp;
+	task_ready_tail = tp;
+}
+
+
+/** Take the first task off of the ready list.  The list must not
+ * be empty. */
+static inline task_t *task_ready_pop (void)
+{
+	task_t *tp = task_ready_head;
+	task_ready_head = tp->next;
+	if (task_ready_head)
+		task_ready_head->prev = NULL;
+	else
+		task_ready_tail = NULL;
+	return tp;
+}
+
+
+/** Remove a task from the ready list. */
+static void task_ready_remove (task_t *tp)
+{
+	if (tp->prev)
+		tp->prev->next = tp->next;
+	else
+		task_ready_head = tp->next;
+
+	if (tp->next)
+		tp->next->prev = tp->prev;
+	else
+		task_ready_tail = tp->prev;
+}
+
+
+/** Put a sleeping task onto the timer wheel.  If its wakeup time
+ * has already been passed by the wheel, then it is filed under the
+ * current tick instead, so that it runs again on the next pass but
+ * cannot starve the periodic functions. */
+static void task_wheel_add (task_t *tp)
+{
+	task_t **tpp;
+
+	if ((tp->wakeup - task_wheel_time) & 0x8000UL)
+		tp->wakeup = task_wheel_time;
+
+	tpp = &task_wheel[tp->wakeup & (TASK_WHEEL_SIZE-1)];
+	tp->next = *tpp;
+	tp->prev = NULL;
+	if (*tpp)
+		(*tpp)->prev = tp;
+	*tpp = tp;
+}
+
+
+/** Remove a sleeping task from the timer wheel.  The first task on
+ * a list has no previous task; the list head is found from its wakeup
+ * time instead. */
+static void task_wheel_remove (task_t *tp)
+{
+	if (tp->prev)
+		tp->prev->next = tp->next;
+	else
+		task_wheel[tp->wakeup & (TASK_WHEEL_SIZE-1)] = tp->next;
+
+	if (tp->next)
+		tp->next->prev = tp->prev;
+}
+
+
+/** Advance the timer wheel up to the current system time.  For each
+ * tick that has elapsed, the tasks on that tick's list whose wakeup time
+ * has arrived are unblocked and moved to the ready list.  Normally this
+ * is called once per tick, but it catches up if ticks were missed. */
+static void task_wheel_advance (void)
+{
+	task_t **tpp;
+	task_t *tp;
+
+	while (task_wheel_time != get_sys_time ())
+	{
+		tpp = &task_wheel[task_wheel_time & (TASK_WHEEL_SIZE-1)];
+		while ((tp = *tpp) != NULL)
+		{
+			if ((task_wheel_time - tp->wakeup) & 0x8000UL)
+				tpp = &tp->next;
+			else
+			{
+				task_wheel_remove (tp);
+				tp->state &= ~TASK_BLOCKED;
+				task_ready_add (tp);
+			}
+		}
+		task_wheel_time++;
+	}
+}
+
+
+/** Link a task onto the hash chain for its group ID. */
+static inline void task_gid_link (task_t *tp)
+{
+	task_t **tpp = &task_gid_hash[tp->gid & (TASK_GID_HASH_SIZE-1)];
+	tp->gid_next = *tpp;
+	*tpp = tp;
+}
+
+
+/** Unlink a task from the hash chain for its group ID. */
+static void task_gid_unlink (task_t *tp)
+{
+	task_t **tpp;
+
+	for (tpp = &task_gid_hash[tp->gid & (TASK_GID_HASH_SIZE-1)];
+		*tpp; tpp = &(*tpp)->gid_next)
+		if (*tpp == tp)
+		{
+			*tpp = tp->gid_next;
+			return;
+		}
+}
+
+
+#ifdef CONFIG_TASK_PROFILE
+/** Clear all of the task profiling data. */
+void task_profile_reset (void)
+{
+	disable_irq ();
+	memset (task_profile_table, 0, sizeof (task_profile_table));
+	memset (task_profile_latency, 0, sizeof (task_profile_latency));
+	task_profile_count = 0;
+	task_profile_idle_time = 0;
+	task_profile_current = NULL;
+	enable_irq ();
+}
+
+
+/** Return the profile entry for a group ID, assigning a new one if this
+ * group has not been seen before. */
+static task_profile_t *task_profile_find (task_gid_t gid)
+{
+	task_profile_t *prof;
+	U8 n;
+
+	for (prof = task_profile_table, n = task_profile_count; n; prof++, n--)
+		if (prof->gid == gid)
+			return prof;
+
+	if (task_profile_count < TASK_PROFILE_SLOTS-1)
+	{
+		prof->gid = gid;
+		task_profile_count++;
+		return prof;
+	}
+	return &task_profile_table[TASK_PROFILE_SLOTS-1];
+}
+
+
+/** Update the profile when a task is about to be dispatched.  Its wakeup
+ * time says when it became ready to run. */
+static void task_profile_dispatch (task_t *tp)
+{
+	task_profile_t *prof = task_profile_find (tp->gid);
+	U16 latency = get_sys_time () - tp->wakeup;
+	U8 bucket;
+
+	if (latency > 0xFF)
+		latency = 0xFF;
+	if (latency > prof->max_latency)
+		prof->max_latency = latency;
+
+	if (latency <= 2)
+		bucket = latency;
+	else if (latency <= 4)
+		bucket = 3;
+	else if (latency <= 8)
+		bucket = 4;
+	else
+		bucket = 5;
+	task_profile_latency[bucket]++;
+
+	prof->dispatches++;
+	task_profile_current = prof;
+}
+
+
+/** Print the task profile to the debugger port. */
+void task_profile_dump (void)
+{
+#ifdef DEBUGGER
+	task_profile_t *prof;
+	U8 n;
+
+	dbprintf ("GID  RUN    DISP   MAXLAT\n");
+	for (prof = task_profile_table, n = 0; n < TASK_PROFILE_SLOTS; prof++, n++)
+	{
+		if (prof->dispatches == 0)
+			continue;
+		if (n == TASK_PROFILE_SLOTS-1)
+			dbprintf ("---");
+		else
+			dbprintf ("%3d", prof->gid);
+		dbprintf ("  %5ld  %5ld  %d\n",
+			prof->run_time, prof->dispatches, prof->max_latency);
+	}
+	dbprintf ("Idle/system = %ld\n", task_profile_idle_time);
+	dbprintf ("Latency: %ld %ld %ld %ld %ld %ld\n",
+		task_profile_latency[0], task_profile_latency[1],
+		task_profile_latency[2], task_profile_latency[3],
+		task_profile_latency[4], task_profile_latency[5]);
+#endif
+}
+#endif /* CONFIG_TASK_PROFILE */
+
+
 /**
  * Allocate a block for a new task.  Failure to allocate a block
  * is considered fatal.  If successfully allocated, the block
@@ -358,6 +641,7 @@ task_t *task_allocate (void)
 		tp->aux_stack_block = -1;
 #endif
 		tp->duration = TASK_DURATION_BALL;
+		task_ready_add (tp);
 		return tp;
 	}
 	else
@@ -408,6 +692,8 @@ task_t *task_expand_stack (task_t *tp)
 /** Free a task block for a task that no longer exists. */
 static void task_free (task_t *tp)
 {
+	task_gid_unlink (tp);
+
 #ifdef CONFIG_EXPAND_STACK
 	/* Free the auxiliary stack block first if it exists */
 	if (tp->aux_stack_block != -1)
@@ -431,7 +717,8 @@ task_t *task_create_gid (task_gid_t gid, task_function_t fn)
 	 * here).  It also declares that 'd' is destroyed by the call. */
 	__asm__ volatile ("jsr\t_task_create" : "=r" (tp) : "0" (fn_x) : "d");
 	tp->gid = gid;
-	tp->wakeup = 0;
+	task_gid_link (tp);
+	tp->wakeup = get_sys_time ();
 	tp->arg.u16 = 0;
 #ifdef CONFIG_DEBUG_TASKCOUNT
 	task_count++;
@@ -443,6 +730,29 @@ task_t *task_create_gid (task_gid_t gid, task_function_t fn)
 }
 
 
+#ifdef CONFIG_TASK_FORK
+/** Allocate the block for a child of task_fork().  The child
+ * inherits the parent's group ID and is linked onto its hash chain
+ * just as task_create_gid() does, so that task_find_gid() and
+ * task_kill_gid() see it. */
+task_t *task_fork_allocate (void)
+{
+	task_t *tp = task_allocate ();
+	tp->gid = task_current->gid;
+	task_gid_link (tp);
+	tp->wakeup = get_sys_time ();
+	tp->arg = task_current->arg;
+#ifdef CONFIG_DEBUG_TASKCOUNT
+	task_count++;
+	if (task_count > task_max_count)
+		task_max_count = task_count;
+#endif
+	log_event (SEV_DEBUG, MOD_TASK, EV_TASK_START, tp->gid);
+	return (tp);
+}
+#endif
+
+
 /** Create a task, but not if a task with the same GID already exists.
  * The previous task will continue to run. */
 task_t *task_create_gid1 (task_gid_t gid, task_function_t fn)
@@ -471,7 +781,9 @@ task_t *task_recreate_gid (task_gid_t gid, task_function_t fn)
 /** Change the GID of the currently running task */
 void task_setgid (task_gid_t gid)
 {
+	task_gid_unlink (task_current);
 	task_current->gid = gid;
+	task_gid_link (task_current);
 }
 
 
@@ -533,6 +845,29 @@ void task_sleep_periodic (void)
 }
 
 
+/** Suspend the current task until it is woken by task_wakeup(), or
+until the given time has passed, whichever comes first. */
+void task_wait (task_ticks_t ticks)
+{
+	task_sleep (ticks);
+}
+
+
+/** Wake up a task that is suspended in task_wait().  It is taken off of
+the timer wheel and put on the ready list, so it runs on the next pass.
+Nothing happens if the task is not asleep. */
+void task_wakeup (task_t *tp)
+{
+	if (tp->state & TASK_BLOCKED)
+	{
+		task_wheel_remove (tp);
+		tp->state &= ~TASK_BLOCKED;
+		tp->wakeup = get_sys_time ();
+		task_ready_add (tp);
+	}
+}
+
+
 /**
  * Exit the current task, and return to the dispatcher to select
  * another task to start running now.
@@ -564,15 +899,21 @@ void task_exit (void)
 task_t *task_find_gid_next (task_t *last, task_gid_t gid)
 {
 	register task_t *tp;
-	for (tp = last+1; tp < task_tail; tp++)
-		if ((tp->state & BLOCK_TASK) && (tp->gid == gid))
+	task_gid_lookups++;
+	for (tp = last->gid_next; tp; tp = tp->gid_next)
+		if (tp->gid == gid)
 			return (tp);
 	return (NULL);
 }
 
 task_t *task_find_gid (task_gid_t gid)
 {
-	return task_find_gid_next (task_buffer-1, gid);
+	register task_t *tp;
+	task_gid_lookups++;
+	for (tp = task_gid_hash[gid & (TASK_GID_HASH_SIZE-1)]; tp; tp = tp->gid_next)
+		if (tp->gid == gid)
+			return (tp);
+	return (NULL);
 }
 
 
@@ -585,6 +926,10 @@ void task_kill_pid (task_t *tp)
 	if (tp == task_current)
 		fatal (ERR_TASK_KILL_CURRENT);
 
+	if (tp->state & TASK_BLOCKED)
+		task_wheel_remove (tp);
+	else
+		task_ready_remove (tp);
 	task_free (tp);
 	tp->gid = 0;
 #ifdef CONFIG_DEBUG_TASKCOUNT
@@ -601,17 +946,20 @@ void task_kill_pid (task_t *tp)
 bool task_kill_gid (task_gid_t gid)
 {
 	register task_t *tp;
+	task_t *next;
 	bool rc = FALSE;
 
 	log_event (SEV_DEBUG, MOD_TASK, EV_TASK_KILL, gid);
-	for (tp = task_buffer; tp < task_tail; tp++)
-		if (	(tp != task_current) &&
-				(tp->state & BLOCK_TASK) && 
-				(tp->gid == gid) )
+	task_gid_lookups++;
+	for (tp = task_gid_hash[gid & (TASK_GID_HASH_SIZE-1)]; tp; tp = next)
+	{
+		next = tp->gid_next;
+		if ((tp != task_current) && (tp->gid == gid))
 		{
 			task_kill_pid (tp);
 			rc = TRUE;
 		}
+	}
 	return (rc);
 }
 
@@ -711,20 +1059,22 @@ void *task_alloca (task_t *tp, U8 size)
  *
  * This is called from two places: when a task exits, or when a
  * task sleeps/yields.  The parameter 'tp' points to
- * the previous task's task structure pointer.  The search for a new
- * task to run starts with the next task in the table.  Code then
- * jumps back to the first candidate that is eligible, via
- * the task_restore() assembly language routine.
+ * the previous task's task structure pointer.  If that task went to
+ * sleep, it is filed onto the timer wheel according to its wakeup time.
+ * The next task to run is then taken from the head of the ready list,
+ * and control jumps to it via the task_restore() assembly language routine.
+ * Tasks that are asleep are never looked at here.
  *
- * After the last entry in the task table is scanned, we execute all of the
- * periodic functions.  These functions do not run in task context and cannot
- * sleep.  They are for fixed system components that always need to be
- * scheduled.
+ * When the ready list is empty, a pass is complete and we execute all of
+ * the periodic functions.  These functions do not run in task context and
+ * cannot sleep.  They are for fixed system components that always need
+ * to be scheduled.
  *
  * After the periodic functions finish, we ensure that the system time
- * (in 16ms units) has advanced at least 1 tick before dispatching again from
- * the top of the task table.  This ensures that the periodic functions do
- * not run more often than once per 16ms.
+ * (in 16ms units) has advanced at least 1 tick before dispatching again.
+ * The timer wheel is then advanced, which moves all tasks whose wakeup
+ * time has arrived onto the ready list.  This ensures that the periodic
+ * functions do not run more often than once per 16ms.
  *
  * Historical note: in earlier versions of FreeWPC, periodic functions were
  * called "idle functions", and they would only run if no tasks were queued.
@@ -737,55 +1087,56 @@ void task_dispatcher (task_t *tp)
 {
 	task_dispatching_ok = TRUE;
 	task_current = 0;
+#ifdef CONFIG_TASK_PROFILE
+	task_profile_current = NULL;
+#endif
 
-	/* Go into an infinite loop looking for a task ready to run.
-	Start with the task after the one that was just saved. */
-	for (tp++; ; tp++)
-	{
-		/* When we reach the end of the task table, call the
-		periodic functions. */
-		if (unlikely (tp == task_tail))
-		{
-			/* Call the debugger.  This is not implemented as a true
-			'idle' event below because it should _always_ be called,
-			even when 'periodic_ok' is not true.  This lets us
-			debug very early initialization. */
-			db_periodic ();
-
-			/* If the system is fully initialized, run the periodic functions. */
-			if (likely (periodic_ok))
-				do_periodic ();
-
-			/* Wait for time to change before continuing.  This ensures that
-			the task table+periodic functions are not scanned/called more
-			frequently than once per 16ms. */
-			while (likely (last_dispatch_time == get_sys_time ()))
-				cpu_idle ();
-			last_dispatch_time = get_sys_time ();
-			task_dispatching_ok = TRUE;
-			
-			/* Reset to the beginning of the task table */
-			tp = &task_buffer[0];
-		}
+	/* Put the previous task back onto the right list.  A task that
+	has exited has already been freed and is not put anywhere. */
+	if (tp->state & TASK_BLOCKED)
+		task_wheel_add (tp);
+	else if (tp->state & BLOCK_TASK)
+		task_ready_add (tp);
 
-		/* Only scan blocks that are currently used by a task.  This skips free blocks
-		and blocks used for other purposes. */
-		if (tp->state & (BLOCK_USED | BLOCK_TASK))
+	for (;;)
+	{
+		/* Run the first task on the ready list, if there is one. */
+		if (likely (task_ready_head))
 		{
-			/* See if the task is asleep and should be enabled again.
-			Compare the time at which it wants to wake up with the current time.
-			The subtraction should yield a negative value when it is ready.  If
-			still not ready, then move on to the next task. */
-			if (tp->state & TASK_BLOCKED)
-			{
-				if (time_reached_p (tp->wakeup))
-					tp->state &= ~TASK_BLOCKED;
-				else
-					continue;
-			}
-
+			tp = task_ready_pop ();
+#ifdef CONFIG_TASK_PROFILE
+			task_profile_dispatch (tp);
+#endif
 			task_restore (tp);
 		}
+
+		/* Call the debugger.  This is not implemented as a true
+		'idle' event below because it should _always_ be called,
+		even when 'periodic_ok' is not true.  This lets us
+		debug very early initialization. */
+		db_periodic ();
+
+		/* If the system is fully initialized, run the periodic functions. */
+		if (likely (periodic_ok))
+			do_periodic ();
+
+		/* Wait for time to change before continuing.  This ensures that
+		the periodic functions are not called more frequently than once
+		per 16ms. */
+		while (likely (last_dispatch_time == get_sys_time ()))
+			cpu_idle ();
+		last_dispatch_time = get_sys_time ();
+		task_dispatching_ok = TRUE;
+
+		/* Take a snapshot of how many group ID lookups were done during
+		the last tick. */
+		task_gid_lookups_last = task_gid_lookups;
+		if (task_gid_lookups > task_gid_lookups_max)
+			task_gid_lookups_max = task_gid_lookups;
+		task_gid_lookups = 0;
+
+		/* Wake up all of the tasks whose time has come. */
+		task_wheel_advance ();
 	}
 }
 
@@ -826,11 +1177,24 @@ void task_init (void)
 	last_dispatch_time = 0;
 	idle_time = 0;
 
+	/* Initialize the scheduler lists. */
+	task_ready_head = task_ready_tail = NULL;
+	memset (task_wheel, 0, sizeof (task_wheel));
+	task_wheel_time = get_sys_time ();
+	memset (task_gid_hash, 0, sizeof (task_gid_hash));
+	task_gid_lookups = task_gid_lookups_last = task_gid_lookups_max = 0;
+#ifdef CONFIG_TASK_PROFILE
+	task_profile_reset ();
+#endif
+
 	/* Allocate a task for the first (current) thread of execution.
 	 * The calling routine can then sleep and/or create new tasks
-	 * after this point. */
+	 * after this point.  It is already running, so take it back off
+	 * of the ready list. */
 	task_current = task_allocate ();
 	task_current->gid = GID_FIRST_TASK;
+	task_gid_link (task_current);
 	task_current->arg.u16 = 0;
+	task_ready_head = task_ready_tail = NULL;
 }
 
@@ -27,13 +27,13 @@ STACK_BASE         = 0x17F5
 WPC_ROM_BANK       = 0x3FFC
 
 STATE_OFF          = 0
-PCREG_SAVE_OFF     = 3
-YREG_SAVE_OFF      = 5
-UREG_SAVE_OFF      = 7
-ROMPAGE_SAVE_OFF   = 9
-SAVED_STACK_SIZE   = 10
-AUX_STACK_OFF      = 15
-STACK_SAVE_OFF     = 18
+PCREG_SAVE_OFF     = 2
+YREG_SAVE_OFF      = 4
+UREG_SAVE_OFF      = 6
+ROMPAGE_SAVE_OFF   = 8
+SAVED_STACK_SIZE   = 9
+AUX_STACK_OFF      = 14
+STACK_SAVE_OFF     = 22
 
 ; Because we save in multiples of 8 bytes at a time,
 ; this should always be a multiple of 8 also.
@@ -300,8 +300,9 @@ _task_fork:
 	pshs	u
 
 	; Allocate a new task block for the child,
-	; returned in X.
-	jsr	_task_allocate
+	; returned in X.  It is given the parent's
+	; group ID and hashed like any other task.
+	jsr	_task_fork_allocate
 
 	; Set the child's 'U' register to the
 	; starting point, which is the PC on the stack.
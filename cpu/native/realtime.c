@@ -29,6 +29,27 @@
  */
 unsigned long realtime_counter;
 
+/**
+ * When nonzero, the simulation runs in virtual time: the clock is not
+ * paced by the wall clock, but advances as soon as every task that is
+ * ready to run has had a chance to do so.  Task sleeps are measured
+ * against the simulation clock too, so events happen in the same order
+ * as in real time, only sooner.
+ */
+int realtime_turbo;
+
+/**
+ * The most times that the clock waits for ready tasks before advancing
+ * anyway.  This keeps a task that polls with task_yield from holding
+ * the clock still.
+ */
+#define TURBO_MAX_YIELDS 64
+
+/**
+ * The wall clock time at which the realtime loop started.
+ */
+static struct timeval realtime_start;
+
 
 /**
  * Returns the current simulation time.
@@ -39,6 +60,79 @@ unsigned long realtime_read (void)
 }
 
 
+/**
+ * Advance the simulation time by one millisecond.
+ */
+static void realtime_step (void)
+{
+	realtime_counter++;
+	callset_invoke (realtime_tick);
+}
+
+
+/**
+ * Returns nonzero once the simulation time given as ARG has been reached.
+ * This is polled by the pth scheduler for tasks sleeping in turbo mode.
+ */
+static int realtime_reached (void *arg)
+{
+	return realtime_counter >= (unsigned long)arg;
+}
+
+
+/**
+ * Sleep for a number of milliseconds of simulation time.  This is used
+ * for task sleeps in turbo mode.
+ */
+void realtime_sleep (unsigned long msecs)
+{
+	pth_event_t ev = pth_event (PTH_EVENT_FUNC, realtime_reached,
+		(void *)(realtime_counter + msecs), pth_time (0, 0));
+	pth_wait (ev);
+	pth_event_free (ev, PTH_FREE_THIS);
+}
+
+
+/**
+ * Log how fast the simulation ran compared to the wall clock.
+ */
+void realtime_report (void)
+{
+	struct timeval now;
+	unsigned long wall_ms;
+
+	gettimeofday (&now, NULL);
+	wall_ms = (now.tv_sec - realtime_start.tv_sec) * 1000
+		+ (now.tv_usec - realtime_start.tv_usec) / 1000;
+	if (wall_ms == 0)
+		wall_ms = 1;
+	simlog (SLC_DEBUG, "Simulated %lu ms in %lu ms (%lu.%01lux)",
+		realtime_counter, wall_ms, realtime_counter / wall_ms,
+		(realtime_counter * 10 / wall_ms) % 10);
+}
+
+
+/**
+ * The realtime loop for turbo mode.  Before each simulated millisecond,
+ * yield until no other task is ready to run.  The first yield also lets
+ * the scheduler wake any task whose sleep has expired.
+ */
+static void realtime_turbo_loop (void)
+{
+	int n;
+
+	for (;;)
+	{
+		n = 0;
+		do {
+			pth_yield (NULL);
+		} while (pth_ctrl (PTH_CTRL_GETTHREADS_READY) > 0
+			&& ++n < TURBO_MAX_YIELDS);
+		realtime_step ();
+	}
+}
+
+
 /**
  * Implement a realtime loop on a non-realtime OS.
  *
@@ -55,6 +149,10 @@ void realtime_loop (void)
 	int latency;
 #endif
 
+	gettimeofday (&realtime_start, NULL);
+	if (realtime_turbo)
+		realtime_turbo_loop ();
+
 	gettimeofday (&prev_time, NULL);
 	for (;;)
 	{
@@ -104,15 +202,13 @@ void realtime_loop (void)
 		/* Invoke realtime tick at least once every time through the loop.
 		So if we slept < 1ms (either the OS lied to us, or we didn't sleep at all),
 		we'll make forward progress. */
-		realtime_counter++;
-		callset_invoke (realtime_tick);
+		realtime_step ();
 		usecs_elapsed -= usecs_asked;
 
 		/* If any remaining millseconds occurred during the wait, handle them */
 		while (usecs_elapsed >= 1000)
 		{
-			realtime_counter++;
-			callset_invoke (realtime_tick);
+			realtime_step ();
 			usecs_elapsed -= 1000;
 		}
 
@@ -40,7 +40,14 @@ U8 task_count = 0;
 
 U8 task_max_count = 0;
 
+/** The number of tasks created since startup.  The simulator exposes
+ * this to scripts, so that they can measure task creation rates. */
+int task_create_count = 0;
+
 extern int linux_irq_multiplier;
+extern int realtime_turbo;
+extern void realtime_sleep (unsigned long msecs);
+extern unsigned long realtime_read (void);
 
 #define PTH_USECS_PER_TICK (16000 / linux_irq_multiplier)
 
@@ -54,11 +61,54 @@ typedef struct
 	task_gid_t gid;
 	PTR_OR_U16 arg;
 	U8 duration;
+	int gid_next;
+	int woken;
+	unsigned long wait_until;
 	unsigned char class_data[32];
 } aux_task_data_t;
 
 aux_task_data_t task_data_table[NUM_TASKS];
 
+/** The number of chains in the group ID hash table.  This must be a
+ * power of 2. */
+#define TASK_GID_HASH_SIZE 16
+
+/** The first table slot on each group ID hash chain, or -1 if the chain
+ * is empty.  Slots on a chain are linked through gid_next. */
+int task_gid_hash[TASK_GID_HASH_SIZE];
+
+/** The number of group ID lookups made during the current tick. */
+U16 task_gid_lookups;
+
+/** The number of group ID lookups made during the previous tick, and the
+ * largest number seen in any one tick. */
+U16 task_gid_lookups_last;
+U16 task_gid_lookups_max;
+
+
+/** Link a table slot onto the hash chain for its group ID. */
+static void task_gid_link (int i)
+{
+	int *head = &task_gid_hash[task_data_table[i].gid & (TASK_GID_HASH_SIZE-1)];
+	task_data_table[i].gid_next = *head;
+	*head = i;
+}
+
+
+/** Unlink a table slot from the hash chain for its group ID. */
+static void task_gid_unlink (int i)
+{
+	int *ip;
+
+	for (ip = &task_gid_hash[task_data_table[i].gid & (TASK_GID_HASH_SIZE-1)];
+		*ip != -1; ip = &task_data_table[*ip].gid_next)
+		if (*ip == i)
+		{
+			*ip = task_data_table[i].gid_next;
+			return;
+		}
+}
+
 
 void task_dump (void)
 {
@@ -77,6 +127,8 @@ void task_dump (void)
 				td->gid, td->arg.u16, td->duration);
 		}
 	}
+	dbprintf ("GID lookups/tick = %d, max %d\n",
+		task_gid_lookups_last, task_gid_lookups_max);
 }
 
 
@@ -103,11 +155,15 @@ task_pid_t task_create_gid (task_gid_t gid, task_function_t fn)
 	 * - cancellable : task kill is permitted
 	 * - priority : make certain tasks that the simulator itself
 	 *   uses higher priority, and all others equal in priority.
+	 *   In turbo mode, time tracking is lowest priority instead, so
+	 *   that the clock only advances when every task is waiting.
 	 */
 	attr = pth_attr_new ();
 	pth_attr_set (attr, PTH_ATTR_JOINABLE, FALSE);
 	pth_attr_set (attr, PTH_ATTR_CANCEL_STATE, PTH_CANCEL_ENABLE);
-	if (gid == GID_LINUX_REALTIME) /* time tracking */
+	if (gid == GID_LINUX_REALTIME && realtime_turbo)
+		pth_attr_set (attr, PTH_ATTR_PRIO, PTH_PRIO_MIN);
+	else if (gid == GID_LINUX_REALTIME) /* time tracking */
 		pth_attr_set (attr, PTH_ATTR_PRIO, PTH_PRIO_STD + 2);
 	else if (gid == GID_LINUX_INTERFACE) /* user input */
 		pth_attr_set (attr, PTH_ATTR_PRIO, PTH_PRIO_STD + 1);
@@ -116,6 +172,7 @@ task_pid_t task_create_gid (task_gid_t gid, task_function_t fn)
 	 * function and pass it a pointer to the task_data_table entry
 	 * as an argument. */
 	pid = pth_spawn (attr, fn, 0);
+	task_create_count++;
 
 	for (i=0; i < NUM_TASKS; i++)
 		if (task_data_table[i].pid == 0)
@@ -125,6 +182,7 @@ task_pid_t task_create_gid (task_gid_t gid, task_function_t fn)
 			task_data_table[i].duration = TASK_DURATION_INF;
 			task_data_table[i].arg.u16 = 0;
 			task_data_table[i].duration = TASK_DURATION_BALL;
+			task_gid_link (i);
 			ui_write_task (i, gid);
 			return (pid);
 		}
@@ -159,7 +217,9 @@ void task_setgid (task_gid_t gid)
 	for (i=0; i < NUM_TASKS; i++)
 		if (task_data_table[i].pid == task_getpid ())
 		{
+			task_gid_unlink (i);
 			task_data_table[i].gid = gid;
+			task_gid_link (i);
 			break;
 		}
 }
@@ -169,7 +229,56 @@ void task_sleep (task_ticks_t ticks)
 #ifdef PTHDEBUG2
 	printf ("task_sleep(%d)\n", ticks);
 #endif
-	pth_nap (pth_time (0, ticks * PTH_USECS_PER_TICK));
+	if (realtime_turbo)
+		realtime_sleep ((unsigned long)ticks * IRQS_PER_TICK);
+	else
+		pth_nap (pth_time (0, ticks * PTH_USECS_PER_TICK));
+}
+
+
+/** Returns nonzero when a task in task_wait() should resume.  This is
+ * polled by the pth scheduler. */
+static int task_wait_done (void *arg)
+{
+	aux_task_data_t *td = arg;
+	return td->woken || (realtime_turbo && realtime_read () >= td->wait_until);
+}
+
+
+void task_wait (task_ticks_t ticks)
+{
+	pth_event_t ev;
+	int i;
+
+	for (i=0; i < NUM_TASKS; i++)
+		if (task_data_table[i].pid == task_getpid ())
+		{
+			aux_task_data_t *td = &task_data_table[i];
+
+			td->woken = 0;
+			td->wait_until = realtime_read () + (unsigned long)ticks * IRQS_PER_TICK;
+			ev = pth_event (PTH_EVENT_FUNC, task_wait_done, td, pth_time (0, 0));
+			if (!realtime_turbo)
+				pth_event_concat (ev, pth_event (PTH_EVENT_TIME,
+					pth_timeout (0, ticks * PTH_USECS_PER_TICK)), NULL);
+			pth_wait (ev);
+			pth_event_free (ev, PTH_FREE_ALL);
+			return;
+		}
+	fatal (ERR_CANT_GET_HERE);
+}
+
+
+void task_wakeup (task_pid_t tp)
+{
+	int i;
+
+	for (i=0; i < NUM_TASKS; i++)
+		if (task_data_table[i].pid == tp)
+		{
+			task_data_table[i].woken = 1;
+			return;
+		}
 }
 
 
@@ -194,6 +303,7 @@ void task_exit (void)
 	for (i=0; i < NUM_TASKS; i++)
 		if (task_data_table[i].pid == task_getpid ())
 		{
+			task_gid_unlink (i);
 			task_data_table[i].pid = 0;
 			ui_write_task (i, 0);
 			for (;;)
@@ -205,10 +315,11 @@ void task_exit (void)
 task_pid_t task_find_gid (task_gid_t gid)
 {
 	int i;
-	for (i=0; i < NUM_TASKS; i++)
+	task_gid_lookups++;
+	for (i = task_gid_hash[gid & (TASK_GID_HASH_SIZE-1)]; i != -1;
+		i = task_data_table[i].gid_next)
 	{
-		if ((task_data_table[i].gid == gid)
-			&& (task_data_table[i].pid != 0))
+		if (task_data_table[i].gid == gid)
 			return task_data_table[i].pid;
 	}
 	return NULL;
@@ -219,9 +330,11 @@ task_pid_t task_find_gid_next (task_pid_t last, task_gid_t gid)
 {
 	int i;
 	int ok_to_return = 0;
-	for (i=0; i < NUM_TASKS; i++)
+	task_gid_lookups++;
+	for (i = task_gid_hash[gid & (TASK_GID_HASH_SIZE-1)]; i != -1;
+		i = task_data_table[i].gid_next)
 	{
-		if ((task_data_table[i].gid == gid) && (task_data_table[i].pid != 0))
+		if (task_data_table[i].gid == gid)
 		{
 			if (ok_to_return)
 				return task_data_table[i].pid;
@@ -244,6 +357,7 @@ void task_kill_pid (task_pid_t tp)
 	for (i=0; i < NUM_TASKS; i++)
 		if (task_data_table[i].pid == tp)
 		{
+			task_gid_unlink (i);
 			task_data_table[i].pid = 0;
 			ui_write_task (i, 0);
 			if (tp != 0)
@@ -254,13 +368,14 @@ void task_kill_pid (task_pid_t tp)
 
 bool task_kill_gid (task_gid_t gid)
 {
-	int i;
+	int i, next;
 	bool rc = FALSE;
 
-	for (i=0; i < NUM_TASKS; i++)
+	task_gid_lookups++;
+	for (i = task_gid_hash[gid & (TASK_GID_HASH_SIZE-1)]; i != -1; i = next)
 	{
+		next = task_data_table[i].gid_next;
 		if ((task_data_table[i].gid == gid) &&
-			 (task_data_table[i].pid != 0) &&
 			 (task_data_table[i].pid != task_getpid ()))
 		{
 			task_kill_pid (task_data_table[i].pid);
@@ -416,12 +531,35 @@ void task_set_class_data (task_pid_t pid, size_t size)
 
 void task_init (void)
 {
+	int i;
+
 	memset (task_data_table, 0, sizeof (task_data_table));
+	for (i=0; i < TASK_GID_HASH_SIZE; i++)
+		task_gid_hash[i] = -1;
+	task_gid_lookups = task_gid_lookups_last = task_gid_lookups_max = 0;
 	
 	pth_init ();
 
 	task_data_table[0].pid = task_getpid ();
 	task_data_table[0].gid = GID_FIRST_TASK;
 	task_data_table[0].duration = TASK_DURATION_INF;
+	task_gid_link (0);
+}
+
+
+/** Take a snapshot of the group ID lookup count once per task tick, to
+ * match what the 6809 dispatcher does. */
+CALLSET_ENTRY (task_pth, realtime_tick)
+{
+	static U8 irqs;
+
+	if (++irqs < IRQS_PER_TICK)
+		return;
+	irqs = 0;
+
+	task_gid_lookups_last = task_gid_lookups;
+	if (task_gid_lookups > task_gid_lookups_max)
+		task_gid_lookups_max = task_gid_lookups;
+	task_gid_lookups = 0;
 }
 
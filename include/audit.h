@@ -111,6 +111,7 @@ typedef struct
 	time_audit_t total_game_time; /* done */
 	audit_t hist_score[13];
 	audit_t hist_game_time[13];
+	audit_t switch_queue_overflows; /* done */
 } std_audits_t;
 
 
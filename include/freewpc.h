@@ -189,6 +189,7 @@ __noreturn__ void freewpc_init (void);
 #include <system/sound.h>
 #include <system/switch.h>
 #include <system/flip.h>
+#include <system/swlatency.h>
 #include <system/display.h>
 #ifdef CONFIG_GI
 #include <system/triac.h>
@@ -199,6 +200,7 @@ __noreturn__ void freewpc_init (void);
 #include <priority.h>
 #include <system/deff.h>
 #include <system/leff.h>
+#include <system/lampshow.h>
 #include <system/device.h>
 #include <system/math.h>
 #include <timer.h>
@@ -239,6 +241,11 @@ __noreturn__ void freewpc_init (void);
 /* Automatically generated header files */
 #include <gendefine_gid.h>
 
+/* Automatically include lamp show IDs */
+#ifdef CONFIG_LAMPSHOW
+#include <mach-lampshows.h>
+#endif
+
 /* Automatically include image IDs */
 #ifdef CONFIG_PLATFORM_WPC
 #ifndef NO_MAIN
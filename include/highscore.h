@@ -32,5 +32,8 @@ __common__ void high_score_reset (void);
 __common__ void high_score_reset_check (void);
 __common__ void high_score_check (void);
 __common__ void grand_champion_draw (void);
+#ifdef CONFIG_NATIVE
+void high_score_write_report (FILE *fp);
+#endif
 
 #endif /* _HIGHSCORE_H */
@@ -131,6 +131,7 @@ extern struct ball_node_type open_type_node;
 
 extern struct ball the_ball[];
 
+bool node_full_p (struct ball_node *node);
 void node_insert (struct ball_node *node, struct ball *ball);
 void node_kick (struct ball_node *node);
 void node_move (struct ball_node *dst, struct ball_node *src);
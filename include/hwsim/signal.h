@@ -120,6 +120,7 @@ void signal_capture_stop (struct signal_expression *ex);
 void signal_capture_add (uint32_t signo);
 void signal_capture_del (uint32_t signo);
 void signal_capture_set_file (const char *filename);
+void signal_capture_set_format (const char *format);
 void signal_trace_start (signal_number_t signo);
 void signal_trace_stop (signal_number_t signo);
 
@@ -73,6 +73,9 @@ struct fixed_ladder
 /** A flag that is nonzero when the score screen needs to be updated */
 extern bool score_update_needed;
 
+/** The scores as they were last drawn by the score screen */
+extern score_t scores_drawn[];
+
 /** The array of player scores */
 extern score_t scores[];
 
@@ -125,11 +128,15 @@ __effect__ void scores_draw (void);
 __effect__ void scores_draw_ball (void);
 __effect__ void scores_draw_current (U8 skip_player);
 __effect__ void scores_draw_status_bar (void);
+__effect__ void scores_draw_cache_update (void);
+__effect__ void scores_draw_cache_invalidate (void);
+__effect__ bool scores_draw_changed (void);
 
 /** External low-level functions.  These differ between DMD and
 alphanumeric games. */
 __effect__ void ll_score_change_player (void);
 __effect__ void ll_scores_draw_current (U8);
+__effect__ void ll_scores_draw_changed (U8);
 __effect__ void ll_score_redraw (void);
 __effect__ void ll_score_draw_timed (U8 min, U8 sec);
 __effect__ void ll_score_draw_ball (void);
@@ -51,6 +51,7 @@ typedef unsigned long simulated_time_interval_t;
 struct time_handler
 {
 	struct time_handler *next;
+	unsigned long expires;
 	int periodicity;
 	time_handler_t fn;
 	void *data;
@@ -107,6 +108,13 @@ void sim_switch_depress (int sw);
 void flipper_button_depress (int sw);
 int sim_switch_read (int sw);
 void sim_switch_init (void);
+void sim_switch_replay (int sw, int level);
+
+extern int sim_swtrace_replaying;
+void sim_swtrace_switch (int sw, int level);
+void sim_swtrace_record (const char *filename);
+void sim_swtrace_replay (const char *filename);
+void sim_swtrace_stop (void);
 
 void exec_script (char *cmd);
 void exec_script_file (const char *filename);
@@ -144,6 +152,11 @@ void protected_memory_save (void);
 
 void mach_node_init (void);
 
+void autoplay_shot_add (unsigned int sw, unsigned int weight);
+void autoplay_start (void);
+void autoplay_stop (void);
+void autoplay_init (void);
+
 void sim_init (void);
 __attribute__((noreturn)) void sim_exit (U8);
 
@@ -95,6 +95,10 @@ extern const deff_t deff_table[];
 
 extern void (*deff_component_table[4]) (void);
 
+extern U8 deff_queue_count;
+extern U16 deff_queue_overflows;
+extern U16 deff_queue_expirations;
+
 deffnum_t deff_get_active (void);
 void deff_start (deffnum_t dn);
 void deff_stop (deffnum_t dn);
@@ -109,6 +113,7 @@ void deff_start_sync (deffnum_t dn);
 void deff_init (void);
 void deff_stop_all (void);
 void deff_queue_add (deffnum_t id, U16 timeout);
+void deff_queue_stats_reset (void);
 
 
 /* The deff components module offers inline functions for
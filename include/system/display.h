@@ -86,6 +86,10 @@ equivalents. */
 #define dmd_alloc_pair_clean(args...)
 #define dmd_sched_transition(trans)    //seg_sched_transition (trans)
 #define dmd_reset_transition()         seg_reset_transition ()
+#define dmd_dirty_rows(args...)
+#define dmd_dirty_track_begin()
+#define dmd_dirty_track_end()
+#define dmd_dirty_untracked()
 #define dmd_draw_border(args...)
 #define dmd_draw_horiz_line(args...)
 #define dmd_invert_page(args...)
@@ -146,6 +150,10 @@ text and centered it well. */
 #define dmd_alloc_pair_clean(args...)
 #define dmd_sched_transition(args...)
 #define dmd_reset_transition(args...)
+#define dmd_dirty_rows(args...)
+#define dmd_dirty_track_begin()
+#define dmd_dirty_track_end()
+#define dmd_dirty_untracked()
 #define dmd_draw_border(args...)
 #define dmd_draw_horiz_line(args...)
 #define dmd_invert_page(args...)
@@ -173,6 +173,31 @@ extern inline dmd_pagenum_t dmd_get_blank (const U8 num)
 }
 
 
+extern bool dmd_dirty_tracking;
+void dmd_dirty_mark (const U8 *dbuf, U8 top, U8 height);
+void dmd_dirty_merge (void);
+void dmd_dirty_track_begin (void);
+void dmd_dirty_track_end (void);
+void dmd_dirty_unreported (void);
+
+/** Report that HEIGHT rows, starting at row TOP, of the page mapped at
+ * DBUF have been drawn on.  This is only needed by a deff that has called
+ * dmd_dirty_track_begin() and then writes to the page directly. */
+extern inline void dmd_dirty_rows (const U8 *dbuf, U8 top, U8 height)
+{
+	if (unlikely (dmd_dirty_tracking))
+		dmd_dirty_mark (dbuf, top, height);
+}
+
+/** Report that the mapped pages have been drawn on by code that does
+ * not say which rows it touched, so they must be treated as entirely
+ * dirty. */
+extern inline void dmd_dirty_untracked (void)
+{
+	if (unlikely (dmd_dirty_tracking))
+		dmd_dirty_unreported ();
+}
+
 void dmd_init (void);
 extern __fastram__ void (*dmd_rtt) (void);
 void dmd_alloc_low (void);
@@ -201,6 +226,9 @@ void dmd_reset_transition (void);
 void frame_draw (U16 id);
 void frame_draw2 (U16 id);
 void frame_draw_plane (U16 id);
+bool frame_delta_p (U16 id);
+void frame_stream_begin (void);
+void frame_stream_draw (U16 id);
 void bmp_draw (U8 x, U8 y, U16 id);
 
 __transition__ void dmd_text_outline (void);
@@ -221,13 +249,23 @@ void dmd_xor_page (void);
 #ifdef __m6809__
 void frame_decode_rle_asm (U8 *);
 void frame_decode_sparse_asm (U8 *);
+void frame_decode_lz_asm (U8 *);
+void frame_decode_xor_asm (U8 *);
 void dmd_copy_asm (dmd_buffer_t, dmd_buffer_t);
+void dmd_clean_page_asm (dmd_buffer_t);
 #define frame_decode_rle frame_decode_rle_asm
 #define frame_decode_sparse frame_decode_sparse_asm
+#define frame_decode_lz frame_decode_lz_asm
+#define frame_decode_xor frame_decode_xor_asm
 #else
-/* TODO - no C versions for some of these */
+void frame_decode_rle_c (U8 *);
+void frame_decode_sparse_c (U8 *);
+void frame_decode_lz_c (U8 *);
+void frame_decode_xor_c (U8 *);
 #define frame_decode_rle frame_decode_rle_c
-#define frame_decode_sparse(p)
+#define frame_decode_sparse frame_decode_sparse_c
+#define frame_decode_lz frame_decode_lz_c
+#define frame_decode_xor frame_decode_xor_c
 #endif
 
 extern inline void dmd_map_overlay (void)
@@ -45,6 +45,24 @@ typedef struct font
 } font_t;
 
 
+/**
+ * Pre-shifted glyph data for a font, generated at build time by
+ * tools/fontshift for the fonts listed in PRESHIFT_FONTS.
+ * There are 8 entries for each character from FONT_PRESHIFT_FIRST
+ * to FONT_PRESHIFT_LAST, one per shift value; an entry is NULL if
+ * that character was not generated.  Each glyph begins with the
+ * number of bytes per row, followed by the rows.
+ */
+#define FONT_PRESHIFT_FIRST ','
+#define FONT_PRESHIFT_LAST ':'
+
+struct font_preshift
+{
+	const font_t *font;
+	const U8 *const *glyphs;
+};
+
+
 
 /**
  * An identifier for a symbol, which is just a character within the
@@ -94,6 +112,9 @@ typedef struct
 
 extern __fastram__ fontargs_t font_args;
 
+extern U8 font_string_width;
+extern U8 font_string_height;
+
 
 void font_lookup_char (const font_t *font, char c);
 void fontargs_render_string_center (const char *);
@@ -54,6 +54,38 @@ typedef U8 lamplist_id_t;
 extern __fastram__ U8 lamp_matrix[NUM_LAMP_COLS];
 extern U8 lamp_flash_matrix[NUM_LAMP_COLS];
 extern __fastram__ U8 lamp_flash_matrix_now[NUM_LAMP_COLS];
+extern __fastram__ U8 lamp_output_matrix[NUM_LAMP_COLS];
+extern U8 lamp_dirty[BITS_TO_BYTES (NUM_LAMP_COLS)];
+
+#ifdef CONFIG_LAMP_LEVELS
+/** The number of bits of intensity per lamp.  The default of 2 gives
+ * 4 levels with a modulation cycle of 3 matrix scans.  3 bits give 8
+ * levels, but the cycle is then 7 scans long (about 9Hz), and the
+ * dimmer levels flicker visibly. */
+#ifndef LAMP_LEVEL_BITS
+#define LAMP_LEVEL_BITS 2
+#endif
+
+#if (LAMP_LEVEL_BITS < 1) || (LAMP_LEVEL_BITS > 3)
+#error "LAMP_LEVEL_BITS must be 1, 2 or 3"
+#endif
+
+/** The intensity of a lamp that is fully on */
+#define LAMP_LEVEL_MAX ((1 << LAMP_LEVEL_BITS) - 1)
+
+/** The layers of lamp levels, in the same order as the lamp matrices
+ * that they are combined with */
+#define LAMP_LEVEL_BASE 0
+#define LAMP_LEVEL_LEFF2 1
+#define LAMP_LEVEL_LEFF1 2
+#define LAMP_LEVEL_LAYERS 3
+
+extern U8 lamp_level_planes[LAMP_LEVEL_LAYERS][LAMP_LEVEL_BITS][NUM_LAMP_COLS];
+extern U8 lamp_level_output[LAMP_LEVEL_BITS][NUM_LAMP_COLS];
+extern __fastram__ U8 *lamp_level_plane;
+extern __fastram__ U8 lamp_level_weight;
+extern __fastram__ U8 lamp_level_hold;
+#endif
 
 extern U8 bit_matrix[BITS_TO_BYTES (MAX_FLAGS)];
 extern U8 global_bits[BITS_TO_BYTES (MAX_GLOBAL_FLAGS)];
@@ -81,6 +113,13 @@ typedef enum
 #define LAMP_BREAK (PINIO_NUM_LAMPS + 3)
 
 
+/** Say that the column containing a lamp has changed in one of
+ * the lamp matrices, and its output needs to be recalculated. */
+#define lamp_mark_dirty(lamp) bitarray_set (lamp_dirty, (lamp) / 8)
+
+/** Say that all lamp columns need to be recalculated */
+#define lamp_mark_all_dirty() memset (lamp_dirty, 0xFF, sizeof (lamp_dirty))
+
 void lamp_init (void);
 void lamp_flash_rtt (void);
 void lamp_rtt_0 (void);
@@ -99,6 +138,11 @@ void lamp_flash_on (lampnum_t lamp);
 void lamp_flash_off (lampnum_t lamp);
 bool lamp_flash_test (lampnum_t lamp);
 void lamp_power_set (U8 level);
+#ifdef CONFIG_LAMP_LEVELS
+void lamp_set_level (lampnum_t lamp, U8 level);
+U8 lamp_get_level (lampnum_t lamp);
+void lamp_level_all_off (void);
+#endif
 void leff_on (lampnum_t lamp);
 void leff_off (lampnum_t lamp);
 void leff_toggle (lampnum_t lamp);
@@ -152,6 +196,9 @@ extern inline bool flag_test (const U8 f)
 void bit_on (bitset matrix, U8 bit);
 void bit_off (bitset matrix, U8 bit);
 void bit_toggle (bitset matrix, U8 bit);
+void lamp_bit_on (bitset matrix, lampnum_t lamp);
+void lamp_bit_off (bitset matrix, lampnum_t lamp);
+void lamp_bit_toggle (bitset matrix, lampnum_t lamp);
 bool bit_test (const_bitset matrix, U8 bit);
 bool bit_test_all_on (const_bitset matrix);
 bool bit_test_all_off (const_bitset matrix);
@@ -171,6 +218,11 @@ void lamp_leff2_free (lampnum_t lamp);
 
 const U8 *lamplist_lookup (lamplist_id_t id);
 lampnum_t lamplist_index (lamplist_id_t id, U8 n);
+void lamplist_mask_on (lamplist_id_t id, bitset matrix);
+void lamplist_mask_off (lamplist_id_t id, bitset matrix);
+void lamplist_mask_toggle (lamplist_id_t id, bitset matrix);
+bool lamplist_mask_test_all (lamplist_id_t id, const_bitset matrix);
+bool lamplist_mask_test_any (lamplist_id_t id, const_bitset matrix);
 void lamplist_apply_nomacro (lamplist_id_t id, lamp_operator_t op);
 void lamplist_apply (lamplist_id_t id, lamp_operator_t op);
 
@@ -184,6 +236,7 @@ void lamplist_rotate_next (lamplist_id_t id, bitset matrix);
 void lamplist_rotate_previous (lamplist_id_t id, bitset matrix);
 void lamplist_set_count (lamplist_id_t set, U8 count);
 bool lamplist_test_all (lamplist_id_t id, lamp_boolean_operator_t op);
+bool lamplist_test_any (lamplist_id_t id, lamp_boolean_operator_t op);
 
 __attribute__((noinline)) void matrix_all_on (bitset matrix);
 __attribute__((noinline)) void matrix_all_off (bitset matrix);
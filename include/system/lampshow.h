@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _SYS_LAMPSHOW_H
+#define _SYS_LAMPSHOW_H
+
+#ifdef CONFIG_LAMPSHOW
+
+/* Lamp shows are compiled from the machine's .lsh files by
+ * tools/lampshow.  The table format is documented there. */
+
+/** The show repeats until it is stopped */
+#define LAMPSHOW_LOOP 0x1
+
+/** Marks the end of a show's frames */
+#define LAMPSHOW_END 0xFF
+
+/** The number of shows that can run at the same time */
+#define MAX_RUNNING_LAMPSHOWS 8
+
+typedef U8 lampshow_id_t;
+
+void lampshow_start (lampshow_id_t id);
+void lampshow_stop (lampshow_id_t id);
+bool lampshow_running_p (lampshow_id_t id);
+void lampshow_stop_all (void);
+void lampshow_leff_stop_all (void);
+
+#endif /* CONFIG_LAMPSHOW */
+
+#endif /* _SYS_LAMPSHOW_H */
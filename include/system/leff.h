@@ -121,6 +121,9 @@ extern inline void leff_create_peer (void (*fn)(void))
 	task_inherit_class_data (tp, leff_data_t);
 }
 
+extern U8 leff_queue_count;
+extern U16 leff_queue_overflows;
+
 void leff_start (leffnum_t dn);
 void leff_stop (leffnum_t dn);
 bool leff_running_p (leffnum_t dn);
@@ -103,11 +103,13 @@ void seg_write_row_center (U8 row, const char *s);
 void seg_write_row_right (U8 row, const char *s);
 U8 seg_strlen (const char *s);
 void seg_erase (void);
+void seg_erase_row (U8 row);
 void seg_fill (segbits_t segs);
 void seg_init (void);
 void seg_alloc (void);
 void seg_alloc_clean (void);
 void seg_copy_low_to_high (void);
+void seg_flip_low_high (void);
 void seg_show (void);
 void seg_show_other (void);
 void dmd_rtt (void);
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _SYS_SWHANDLER_H
+#define _SYS_SWHANDLER_H
+
+#include <search.h>
+
+void switch_lamp_pulse_start (const U8 lamp);
+
+/**
+ * The common processing for a switch event.
+ *
+ * genmachine emits one handler per switch in build/mach-swhandlers.c,
+ * each of which expands this with the properties from the machine
+ * description.  As all of the arguments are constants, the checks that
+ * do not apply to a switch are removed at compile time.  switch_process
+ * calls the handler through the 'fn' field of the switch table.  Switches
+ * declared 'unused' have no handler; switch_process expands this for
+ * them itself, with the properties read from the switch table.
+ */
+extern inline void switch_handler_common (const switchnum_t sw,
+	void (*fn) (void), const U8 flags, const U8 lamp,
+	const sound_code_t sound, const U8 devno)
+{
+	/* Don't service switches marked SW_IN_GAME if we're
+	 * not presently in a game.  Don't service switches not marked
+	 * SW_IN_TEST, unless we're actually in test mode */
+	if ((flags & SW_IN_GAME) && !in_game)
+		goto cleanup;
+	if (!(flags & SW_IN_TEST) && in_test)
+		goto cleanup;
+
+	/* If the switch has an associated lamp, then flicker the lamp when
+	 * the switch triggers. */
+	if (lamp && in_live_game)
+		switch_lamp_pulse_start (lamp);
+
+	/* If we're in a live game and the switch declares a standard
+	 * sound, then make it happen. */
+	if (sound && in_live_game)
+		sound_send (sound);
+
+	fn ();
+
+	/* Declare this as a hardware event that affects the random number
+	generator. */
+	random_hw_event ();
+
+	/* If a switch is marked SW_PLAYFIELD and we're in a game,
+	 * then call the global playfield switch handler and check for
+	 * valid playfield.  Also, reset the ball search timer so that
+	 * it doesn't expire.
+	 */
+	if ((flags & SW_PLAYFIELD) && in_game)
+	{
+		callset_invoke (any_pf_switch);
+
+		/* If valid playfield was not asserted yet, then see if this
+		 * switch validates it.  Most playfield switches do this right
+		 * away, but for some switches, like special solenoids (jets
+		 * or slings), which could repeatedly trigger if misaligned,
+		 * count the activations and validate only when some number
+		 * of different switches have triggered.  Device counting
+		 * switches are ignored here, but an 'enter' event will
+		 * set it. */
+		if (!valid_playfield)
+		{
+			if (flags & SW_NOVALID)
+			{
+				if (!devno)
+					try_validate_playfield (sw);
+			}
+			else
+				set_valid_playfield ();
+		}
+		ball_search_timer_reset ();
+	}
+
+cleanup:
+	/* If the switch is part of a device, then let the device
+	 * subsystem process the event.  Note this will always occur
+	 * regardless of any of the above conditions checked. */
+	if (devno)
+		device_sw_handler (devno - 1);
+}
+
+#endif /* _SYS_SWHANDLER_H */
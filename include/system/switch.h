@@ -40,8 +40,8 @@ typedef void (*switch_handler_t) (void);
 typedef struct
 {
 	/** A function to call when the switch produces an event.
-	 * All functions are assumed to be callsets, and located in the
-	 * callset page of the ROM. */
+	 * This is the handler that genmachine specializes for the switch,
+	 * located in the callset page of the ROM. */
 	switch_handler_t fn;
 
 	/** A set of flags that control when switch events are produced */
@@ -50,9 +50,6 @@ typedef struct
 	/** If nonzero, indicates a lamp that is associated with the switch */
 	U8 lamp;
 
-	/** If nonzero, indicates a sound to be made on any switch event */
-	sound_code_t sound;
-
 	/** Indicates how long the switch must remain in the active
 	 * state before an event is generated.   If zero, then only
 	 * a quick 4ms debounce is done.  The value is given
@@ -116,6 +113,7 @@ depending on the system type. */
 typedef U8 switch_bits_t[SWITCH_BITS_SIZE];
 
 extern __fastram__ U8 sw_raw[SWITCH_BITS_SIZE];
+extern __fastram__ U8 sw_edge[SWITCH_BITS_SIZE];
 
 
 /** Poll the raw state of a switch.  Returns zero if open, nonzero
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _SYS_SWLATENCY_H
+#define _SYS_SWLATENCY_H
+
+#ifdef CONFIG_SWITCH_LATENCY
+
+/** The number of switch/coil pairs that can be tracked */
+#define SWITCH_LATENCY_PAIRS 12
+
+/** The number of histogram buckets per pair.  Bucket N counts
+latencies of 2^N to 2^(N+1)-1 milliseconds; bucket 0 also counts 0,
+and the last bucket counts everything larger. */
+#define SWITCH_LATENCY_BUCKETS 8
+
+/** Marks an unused switch or pair entry */
+#define SWITCH_LATENCY_NONE 0xFF
+
+typedef struct
+{
+	U8 sw;
+	U8 sol;
+	U16 count;
+	U16 min;
+	U16 max;
+
+	/* The sum and number of the latencies used for the average.  Both
+	are halved when the sum gets large, so the average favors recent
+	samples once a pair has been hit many times. */
+	U16 total;
+	U16 total_count;
+
+	U16 hist[SWITCH_LATENCY_BUCKETS];
+} switch_latency_pair_t;
+
+extern switch_latency_pair_t switch_latency_table[];
+extern U16 switch_latency_dropped;
+
+void switch_latency_rtt (void);
+void switch_latency_begin (U8 sw);
+void switch_latency_end (void);
+void switch_latency_fire (U8 sol);
+void switch_latency_defer (U8 sol);
+void switch_latency_rt_fire (U8 sw, U8 sol);
+void switch_latency_flipper_rtt (U8 outputs);
+U16 switch_latency_average (const switch_latency_pair_t *pair);
+U16 switch_latency_p99 (const switch_latency_pair_t *pair);
+void switch_latency_reset (void);
+void switch_latency_dump (void);
+
+#else
+
+#define switch_latency_begin(sw)
+#define switch_latency_end()
+#define switch_latency_fire(sol)
+#define switch_latency_defer(sol)
+
+#endif /* CONFIG_SWITCH_LATENCY */
+
+#endif /* _SYS_SWLATENCY_H */
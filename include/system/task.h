@@ -67,7 +67,9 @@ extern void task_set_rom_page (task_pid_t pid, U8 rom_page);
 #define TASK_BLOCKED 0x10
 
 
-/** Define the size of the saved process stack. */
+/** Define the size of the saved process stack.  This must be the same
+ * as TASK_SMALL_SIZE in task_6809.s, which copies the stack 8 bytes at
+ * a time. */
 #define TASK_STACK_SIZE 40
 
 
@@ -88,9 +90,14 @@ typedef void (*task_function_t) (void);
  * allows functions to trash D and X, so they aren't here -- just
  * U and Y.
  *
- * When adding/removing fields to this structure, adjust
- * TASK_STACK_SIZE above accordingly so that the total size is
- * suitably aligned.
+ * When adding/removing fields to this structure, adjust the offsets
+ * at the top of task_6809.s to match.  The fields before 'stack' take
+ * 22 bytes, so each block is 62 bytes and the task table is 2976 bytes.
+ * The space for the scheduler links was found by dropping the unused
+ * 'chain' and 'reserved' bytes; only 'gid_next' adds to the original
+ * 58-byte block.  TASK_STACK_SIZE is left alone, as the save area is
+ * already as small as the 8-byte copy loops allow without forcing
+ * more tasks to overflow it.
  */
 typedef struct task_struct
 {
@@ -99,10 +106,6 @@ typedef struct task_struct
 	 * task; or TASK_BLOCKED for a sleeping task. */
 	U8				state;
 
-	/** The index of the next block in the same chain.  Not used yet.
-	 * A NULL is indicated by a -1, hence it is signed. */
-	S8          chain;
-
 	/** The task group ID.  This is a compile-time assigned value
 	 * used to identify the task.   Multiple running tasks can also
 	 * share the same group ID; operations on a group will affect
@@ -150,8 +153,18 @@ typedef struct task_struct
 	 * stopped automatically due to some external event. */
 	U8				duration;
 
-	/** Not currently used */
-	U8				reserved;
+	/** The next and previous tasks on the same scheduler list.  A task
+	 * that is waiting to run is kept on the ready list; a task that is
+	 * sleeping is kept on one of the wakeup lists.  The running task
+	 * is not on any list.  Both links are kept so that a task can be
+	 * taken off its list without searching it. */
+	struct task_struct *next;
+	struct task_struct *prev;
+
+	/** The next task whose group ID hashes to the same value.  This
+	 * allows tasks to be found by group ID without scanning the whole
+	 * task table. */
+	struct task_struct *gid_next;
 
 	/** The task stack save area.  This is NOT used as the live stack
 	 * area; the live stack is copied here when the task blocks.
@@ -203,6 +216,67 @@ void malloc_chunk_dump (task_t *task);
 void block_free (task_t *tp);
 #endif
 
+extern U16 task_gid_lookups_last;
+extern U16 task_gid_lookups_max;
+
+/**
+ * CONFIG_TASK_PROFILE turns on per-task CPU accounting.  Each time a task
+ * is dispatched, the profile entry for its group ID is updated with the
+ * dispatch count and the time it spent waiting to run; while it runs,
+ * the IRQ charges each 1ms to it.  This is only meaningful on the real
+ * 6809 scheduler, so it is never enabled in native mode.
+ */
+#ifdef CONFIG_NATIVE
+#undef CONFIG_TASK_PROFILE
+#endif
+
+#ifdef CONFIG_TASK_PROFILE
+
+/** The number of group IDs that can be profiled separately.  Tasks
+ * in any other group are accounted together in the last entry. */
+#define TASK_PROFILE_SLOTS 12
+
+/** The number of buckets in the wakeup latency histogram */
+#define TASK_PROFILE_LATENCY_BUCKETS 6
+
+typedef struct
+{
+	/** The group ID being profiled */
+	task_gid_t gid;
+
+	/** The longest time, in ticks, from wakeup until the task ran */
+	U8 max_latency;
+
+	/** The total running time, in IRQs (about 1ms each) */
+	U16 run_time;
+
+	/** The number of times that tasks in this group were dispatched */
+	U16 dispatches;
+} task_profile_t;
+
+extern task_profile_t task_profile_table[TASK_PROFILE_SLOTS];
+extern U8 task_profile_count;
+extern U16 task_profile_latency[TASK_PROFILE_LATENCY_BUCKETS];
+extern U16 task_profile_idle_time;
+extern task_profile_t *task_profile_current;
+
+void task_profile_reset (void);
+void task_profile_dump (void);
+
+/** Charge the current IRQ to the task that it interrupted, or to the
+ * system if no task was running. */
+extern inline void task_profile_rtt (void)
+{
+	if (task_profile_current)
+		task_profile_current->run_time++;
+	else
+		task_profile_idle_time++;
+}
+
+#else
+#define task_profile_rtt()
+#endif /* CONFIG_TASK_PROFILE */
+
 void task_dump (void);
 void task_init (void);
 void task_create (void);
@@ -216,6 +290,8 @@ void task_sleep (task_ticks_t ticks);
 void task_sleep_sec1 (U8 secs);
 void task_set_periodic (task_ticks_t ticks);
 void task_sleep_periodic (void);
+void task_wait (task_ticks_t ticks);
+void task_wakeup (task_pid_t tp);
 __noreturn__ void task_exit (void);
 task_pid_t task_find_gid (task_gid_t);
 task_pid_t task_find_gid_next (task_pid_t first, task_gid_t gid);
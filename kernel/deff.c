@@ -76,14 +76,32 @@ struct deff_queue_entry
 	U16 timeout;
 };
 
+/** The display effects waiting for the display, kept as a binary heap.
+ * The first entry has the highest priority; among equal priorities,
+ * it is the one that expires first. */
 struct deff_queue_entry deff_queue[MAX_QUEUED_DEFFS];
 
+/** The number of entries in deff_queue */
+U8 deff_queue_count;
+
+/** A bitarray in which a '1' means that said deff is queued */
+U8 deffs_queued[BITS_TO_BYTES (MAX_DEFFS)];
+
+/** The number of requests dropped because the queue was full */
+U16 deff_queue_overflows;
+
+/** The number of requests that expired before getting the display */
+U16 deff_queue_expirations;
+
 
 void dump_deffs (void)
 {
 	dbprintf ("Background: %d\n", deff_background);
 	dbprintf ("Running: %d\n", deff_running);
 	dbprintf ("Priority: %d\n", deff_prio);
+	dbprintf ("Queued: %d\n", deff_queue_count);
+	dbprintf ("Overflows: %ld  Expired: %ld\n",
+		deff_queue_overflows, deff_queue_expirations);
 }
 
 
@@ -109,6 +127,7 @@ static void deff_stop_task (void)
 	deff_debug ("deff_stop_task\n");
 	/* TODO : if (!task_find_gid (GID_DEFF_EXITING)) -- not working yet */
 		dmd_reset_transition ();
+	dmd_dirty_track_end ();
 	kickout_unlock (KLOCK_DEFF);
 }
 
@@ -149,71 +168,135 @@ static void deff_start_task (const deff_t *deff)
  */
 void deff_queue_reset (void)
 {
-	struct deff_queue_entry *dq = deff_queue;
-	do
+	deff_queue_count = 0;
+	memset (deffs_queued, 0, sizeof (deffs_queued));
+}
+
+
+/**
+ * Clear the display queue statistics.
+ */
+void deff_queue_stats_reset (void)
+{
+	deff_queue_overflows = 0;
+	deff_queue_expirations = 0;
+}
+
+
+/**
+ * Return true if queue entry A should get the display before entry B.
+ */
+static bool deff_queue_before (const struct deff_queue_entry *a,
+	const struct deff_queue_entry *b)
+{
+	U8 prio_a = deff_table[a->id].prio;
+	U8 prio_b = deff_table[b->id].prio;
+
+	if (prio_a != prio_b)
+		return (prio_a > prio_b);
+	return ((a->timeout - b->timeout) & 0x8000UL) != 0;
+}
+
+
+/**
+ * Swap two display queue entries.
+ */
+static void deff_queue_swap (U8 a, U8 b)
+{
+	struct deff_queue_entry tmp = deff_queue[a];
+	deff_queue[a] = deff_queue[b];
+	deff_queue[b] = tmp;
+}
+
+
+/**
+ * Move a display queue entry towards the top of the heap, until
+ * its parent comes before it.
+ */
+static void deff_queue_sift_up (U8 pos)
+{
+	while (pos > 0)
 	{
-		dq->id = DEFF_NULL;
-		dq->timeout = 0;
-	} while (++dq < deff_queue + MAX_QUEUED_DEFFS);
+		U8 parent = (pos - 1) / 2;
+		if (!deff_queue_before (&deff_queue[pos], &deff_queue[parent]))
+			break;
+		deff_queue_swap (pos, parent);
+		pos = parent;
+	}
 }
 
 
 /**
- * Find a display queue entry with the given id.
- *
- * This can be an actual deff number, or DEFF_NULL if you want to
- * find a free entry.
+ * Move a display queue entry towards the bottom of the heap, until
+ * it comes before both of its children.
  */
-struct deff_queue_entry *deff_queue_find (U8 id)
+static void deff_queue_sift_down (U8 pos)
 {
-	struct deff_queue_entry *dq = deff_queue;
-	do
+	for (;;)
 	{
-		if (dq->id == id)
-			return dq;
-	} while (++dq < deff_queue + MAX_QUEUED_DEFFS);
-	return NULL;
+		U8 child = pos * 2 + 1;
+		U8 best = pos;
+
+		if (child < deff_queue_count
+			&& deff_queue_before (&deff_queue[child], &deff_queue[best]))
+			best = child;
+		child++;
+		if (child < deff_queue_count
+			&& deff_queue_before (&deff_queue[child], &deff_queue[best]))
+			best = child;
+		if (best == pos)
+			break;
+		deff_queue_swap (pos, best);
+		pos = best;
+	}
 }
 
 
 /**
- * Find the display queue entry with the highest priority.
+ * Remove the display queue entry at the given position.
  */
-struct deff_queue_entry *deff_queue_find_priority (void)
+static void deff_queue_remove (U8 pos)
 {
-	struct deff_queue_entry *dq = deff_queue;
-	struct deff_queue_entry *answer = NULL;
-	U8 highest_prio = PRI_NULL;
+	bitarray_clear (deffs_queued, deff_queue[pos].id);
+	deff_queue_count--;
+	if (pos < deff_queue_count)
+	{
+		deff_queue[pos] = deff_queue[deff_queue_count];
+		deff_queue_sift_down (pos);
+		deff_queue_sift_up (pos);
+	}
+}
+
 
-	do
+/**
+ * Remove all of the queued effects whose time has run out.
+ */
+static void deff_queue_expire (void)
+{
+	U8 pos = 0;
+
+	while (pos < deff_queue_count)
 	{
-		if (dq->id != DEFF_NULL)
+		if (time_reached_p (deff_queue[pos].timeout))
 		{
-			const deff_t *deff;
-
-			if (time_reached_p (dq->timeout))
-			{
-				/* This queued effect already expired, so we will
-				ignore it and free it. */
-				dq->id = dq->timeout = 0;
-			}
-			else
-			{
-				deff = &deff_table[dq->id];
-				if (deff->prio > highest_prio)
-				{
-					answer = dq;
-					highest_prio = deff->prio;
-				}
-			}
+			deff_debug ("deff %d expired\n", deff_queue[pos].id);
+			deff_queue_expirations++;
+			deff_queue_remove (pos);
+			/* The removal may have sifted the last entry above this
+			position, so rescan from the top. */
+			pos = 0;
 		}
-	} while (++dq < deff_queue + MAX_QUEUED_DEFFS);
-	return answer;
+		else
+			pos++;
+	}
 }
 
 
 /**
  * Add a new request to the display queue.
+ *
+ * If the queue is full, the request with the lowest priority is dropped,
+ * which may be the new one.
  */
 void deff_queue_add (U8 id, U16 timeout)
 {
@@ -221,18 +304,37 @@ void deff_queue_add (U8 id, U16 timeout)
 
 	/* Ensure that no entry is added to the queue twice.
 	If it's already in there, just return. */
-	dq = deff_queue_find (id);
-	if (dq)
+	if (bitarray_test (deffs_queued, id))
 		return;
 
-	/* Find and initialize a free entry.  If the queue is full, then
-	the effect just won't ever happen. */
-	dq = deff_queue_find (DEFF_NULL);
-	if (dq)
+	if (deff_queue_count == MAX_QUEUED_DEFFS)
 	{
-		dq->id = id;
-		dq->timeout = get_sys_time() + timeout;
+		/* The lowest priority entry is one of the leaves */
+		U8 pos;
+		U8 worst = MAX_QUEUED_DEFFS / 2;
+
+		deff_queue_expire ();
+		if (deff_queue_count == MAX_QUEUED_DEFFS)
+		{
+			deff_queue_overflows++;
+			for (pos = worst + 1; pos < MAX_QUEUED_DEFFS; pos++)
+				if (deff_queue_before (&deff_queue[worst], &deff_queue[pos]))
+					worst = pos;
+			if (deff_table[deff_queue[worst].id].prio >= deff_table[id].prio)
+			{
+				deff_debug ("deff queue full, dropping %d\n", id);
+				return;
+			}
+			deff_debug ("deff queue full, dropping %d\n", deff_queue[worst].id);
+			deff_queue_remove (worst);
+		}
 	}
+
+	dq = &deff_queue[deff_queue_count];
+	dq->id = id;
+	dq->timeout = get_sys_time() + timeout;
+	bitarray_set (deffs_queued, id);
+	deff_queue_sift_up (deff_queue_count++);
 }
 
 
@@ -241,12 +343,16 @@ void deff_queue_add (U8 id, U16 timeout)
  */
 void deff_queue_delete (U8 id)
 {
-	struct deff_queue_entry *dq = deff_queue_find (id);
-	if (dq)
-	{
-		dq->id = 0;
-		dq->timeout = 0;
-	}
+	U8 pos;
+
+	if (!bitarray_test (deffs_queued, id))
+		return;
+	for (pos = 0; pos < deff_queue_count; pos++)
+		if (deff_queue[pos].id == id)
+		{
+			deff_queue_remove (pos);
+			return;
+		}
 }
 
 
@@ -262,15 +368,16 @@ void deff_queue_service (void)
 	/* Find the highest priority effect in the queue.
 	If there is such, start it if its priority exceeds that
 	of the currently display effect. */
-	struct deff_queue_entry *dq = deff_queue_find_priority ();
-	if (dq)
+	deff_queue_expire ();
+	if (deff_queue_count > 0)
 	{
-		const deff_t *deff = &deff_table[dq->id];
+		U8 id = deff_queue[0].id;
+		const deff_t *deff = &deff_table[id];
 		if (deff_prio < deff->prio)
 		{
-			dbprintf ("deff_queue_service starting %d\n", dq->id);
-			deff_running = dq->id;
-			dq->id = dq->timeout = 0;
+			dbprintf ("deff_queue_service starting %d\n", id);
+			deff_running = id;
+			deff_queue_remove (0);
 			deff_start_task (deff);
 			return;
 		}
@@ -307,7 +414,7 @@ void deff_start (deffnum_t id)
 	}
 
 	/* Nothing to do if it's already queued */
-	if (deff_queue_find (id))
+	if (bitarray_test (deffs_queued, id))
 		return;
 
 	/* This effect can take the display now if it has priority.
@@ -384,6 +491,7 @@ __noreturn__ void deff_exit (void)
 	task_setgid (GID_DEFF_EXITING);
 
 	/* Drop priority and clear that we were running */
+	dmd_dirty_track_end ();
 	deff_running = 0;
 	deff_prio = 0;
 
@@ -561,3 +669,16 @@ CALLSET_ENTRY (deff, end_ball)
 	But allow things like "round completion" screens play out. */
 }
 
+
+CALLSET_ENTRY (deff_queue, init)
+{
+	deff_queue_stats_reset ();
+}
+
+
+CALLSET_ENTRY (deff_queue, idle_every_100ms)
+{
+	/* Free queue entries as soon as they expire, rather than
+	waiting for the next time the queue is serviced */
+	deff_queue_expire ();
+}
@@ -69,6 +69,18 @@
  * two pairs are ever needed at once, so there is no concern for
  * overflow.  A few pages are reserved for special use and are
  * always skipped by the allocator.
+ *
+ * A deff that redraws only small parts of the display can opt in to
+ * dirty row tracking with dmd_dirty_track_begin().  For each page, the
+ * range of rows that may be nonblank is then kept up to date by the
+ * drawing functions, and cleaning or copying a page only touches those
+ * rows.  The tracking belongs to the task that began it.  Pages mapped
+ * by any other task are treated as entirely dirty from then on, since
+ * its writes are not reported; and writers that cannot say which rows
+ * they touched, such as the rough copy functions and the score overlay
+ * handlers, mark the mapped pages entirely dirty with
+ * dmd_dirty_untracked().  Tracking ends when the deff stops; at all
+ * other times every page is treated as entirely dirty.
  */
 
 #include <freewpc.h>
@@ -124,6 +136,19 @@ U8 *dmd_trans_data_ptr2;
  */
 U8 dmd_composite_page;
 
+/** For each page, the first row that may be nonblank, and the row
+ * just past the last one.  A blank page has top == PINIO_DMD_HEIGHT
+ * and bottom == 0, so that marking rows is just a min/max. */
+U8 dmd_dirty_top[PINIO_NUM_DMD_PAGES];
+U8 dmd_dirty_bottom[PINIO_NUM_DMD_PAGES];
+
+/** True when a deff is tracking dirty rows */
+bool dmd_dirty_tracking;
+
+/** The task that is tracking dirty rows.  Only its clean and copy
+ * operations may trust dmd_dirty_top/bottom. */
+task_pid_t dmd_dirty_owner;
+
 /* Forward declarations of the 3 phases of the DMD FIRQ functions */
 void dmd_rtt0 (void);
 void dmd_rtt1 (void);
@@ -146,6 +171,112 @@ void dmd_new_rtt (void)
 }
 
 
+/** Mark every page as entirely dirty */
+static void dmd_dirty_all (void)
+{
+	memset (dmd_dirty_top, 0, sizeof (dmd_dirty_top));
+	memset (dmd_dirty_bottom, PINIO_DMD_HEIGHT, sizeof (dmd_dirty_bottom));
+}
+
+
+/** Mark the mapped pages as entirely dirty */
+static void dmd_dirty_all_mapped (void)
+{
+	if (dmd_low_page < PINIO_NUM_DMD_PAGES)
+	{
+		dmd_dirty_top[dmd_low_page] = 0;
+		dmd_dirty_bottom[dmd_low_page] = PINIO_DMD_HEIGHT;
+	}
+	if (dmd_high_page < PINIO_NUM_DMD_PAGES)
+	{
+		dmd_dirty_top[dmd_high_page] = 0;
+		dmd_dirty_bottom[dmd_high_page] = PINIO_DMD_HEIGHT;
+	}
+}
+
+
+/** Return true if the running task owns the dirty row tracking */
+static bool dmd_dirty_owned_p (void)
+{
+	return dmd_dirty_tracking && task_getpid () == dmd_dirty_owner;
+}
+
+
+/** Called after pages have been written in a way that does not report
+ * the rows.  Normally called through dmd_dirty_untracked(). */
+void dmd_dirty_unreported (void)
+{
+	dmd_dirty_all_mapped ();
+}
+
+
+/** Return the number of the page mapped at a buffer address, or
+ * PINIO_NUM_DMD_PAGES if it is not a mapped page. */
+static dmd_pagenum_t dmd_buffer_page (const U8 *dbuf)
+{
+	if (dbuf == dmd_low_buffer)
+		return dmd_low_page;
+	else if (dbuf == dmd_high_buffer)
+		return dmd_high_page;
+	else
+		return PINIO_NUM_DMD_PAGES;
+}
+
+
+/** Add rows to the dirty range of the page mapped at DBUF.
+ * Normally called through dmd_dirty_rows(). */
+void dmd_dirty_mark (const U8 *dbuf, U8 top, U8 height)
+{
+	dmd_pagenum_t page = dmd_buffer_page (dbuf);
+	U8 bottom;
+
+	/* Another task's pages were made entirely dirty when it mapped
+	them, so its reports are not needed. */
+	if (!dmd_dirty_owned_p ())
+		return;
+	if (page >= PINIO_NUM_DMD_PAGES)
+		return;
+	if (top >= PINIO_DMD_HEIGHT)
+		return;
+	bottom = (height > PINIO_DMD_HEIGHT - top) ? PINIO_DMD_HEIGHT : top + height;
+	if (top < dmd_dirty_top[page])
+		dmd_dirty_top[page] = top;
+	if (bottom > dmd_dirty_bottom[page])
+		dmd_dirty_bottom[page] = bottom;
+}
+
+
+/** Add the dirty range of the high page to that of the low page.
+ * Call this after combining the high page into the low one. */
+void dmd_dirty_merge (void)
+{
+	if (likely (!dmd_dirty_owned_p ()))
+		return;
+	if (dmd_dirty_top[dmd_high_page] < dmd_dirty_top[dmd_low_page])
+		dmd_dirty_top[dmd_low_page] = dmd_dirty_top[dmd_high_page];
+	if (dmd_dirty_bottom[dmd_high_page] > dmd_dirty_bottom[dmd_low_page])
+		dmd_dirty_bottom[dmd_low_page] = dmd_dirty_bottom[dmd_high_page];
+}
+
+
+/** Begin dirty row tracking for the running deff.  Every page starts
+ * out entirely dirty, so the first clean of each page is a full one. */
+void dmd_dirty_track_begin (void)
+{
+	dmd_dirty_owner = task_getpid ();
+	dmd_dirty_tracking = TRUE;
+}
+
+
+/** End dirty row tracking.  Writes that follow are not reported, so
+ * every page has to be treated as entirely dirty from now on. */
+void dmd_dirty_track_end (void)
+{
+	dmd_dirty_tracking = FALSE;
+	dmd_dirty_all ();
+}
+
+
 /**
  * Initialize the DMD subsystem.
  */
@@ -156,6 +287,7 @@ void dmd_init (void)
 	dmd_phase_ptr = dmd_phase_table;
 	dmd_in_transition = FALSE;
 	dmd_transition = NULL;
+	dmd_dirty_track_end ();
 
 	/* If DMD_BLANK_PAGE_COUNT is defined, this says how
 	 * many DMD pages should not be allocatable, but should be
@@ -247,6 +379,11 @@ void dmd_map_low_high (dmd_pagenum_t page)
 {
 	pinio_dmd_window_set (PINIO_DMD_WINDOW_0, page);
 	pinio_dmd_window_set (PINIO_DMD_WINDOW_1, page + 1);
+
+	/* A task that does not own the dirty row tracking will not report
+	what it draws on these pages */
+	if (unlikely (dmd_dirty_tracking) && !dmd_dirty_owned_p ())
+		dmd_dirty_all_mapped ();
 }
 
 
@@ -361,20 +498,45 @@ void dmd_show2 (void)
 
 
 /**
- * Clean an entire DMD page.  This is the C portable version
- * of the function; there is a special assembler version of this
- * for the 6809. */
-#ifndef __m6809__
+ * Clean a DMD page.  When dirty rows are tracked, only the rows that
+ * may be nonblank are cleared.  Otherwise the whole page is; there is
+ * a special assembler version of this for the 6809.
+ */
 void dmd_clean_page (dmd_buffer_t dbuf)
 {
+	if (unlikely (dmd_dirty_owned_p ()))
+	{
+		dmd_pagenum_t page = dmd_buffer_page (dbuf);
+		if (page < PINIO_NUM_DMD_PAGES)
+		{
+			U8 top = dmd_dirty_top[page];
+			U8 bottom = dmd_dirty_bottom[page];
+
+			dmd_dirty_top[page] = PINIO_DMD_HEIGHT;
+			dmd_dirty_bottom[page] = 0;
+			if (top >= bottom)
+				return;
+			if (bottom - top < PINIO_DMD_HEIGHT)
+			{
+				__blockclear16 (dbuf + (U16)top * DMD_BYTE_WIDTH,
+					(U16)(bottom - top) * DMD_BYTE_WIDTH);
+				return;
+			}
+		}
+	}
+
+#ifdef __m6809__
+	dmd_clean_page_asm (dbuf);
+#else
 	__blockclear16 (dbuf, DMD_PAGE_SIZE);
+#endif
 }
-#endif /* __m6809__ */
 
 
 void dmd_fill_page_low (void)
 {
 	memset (dmd_low_buffer, 0xFF, DMD_PAGE_SIZE);
+	dmd_dirty_rows (dmd_low_buffer, 0, PINIO_DMD_HEIGHT);
 }
 
 
@@ -407,11 +569,50 @@ void dmd_invert_page (dmd_buffer_t dbuf)
 		*dbuf16 = ~*dbuf16;
 		dbuf16++;
 	}
+	dmd_dirty_rows (dbuf, 0, PINIO_DMD_HEIGHT);
 }
 
 
+/**
+ * Copy a DMD page.  When dirty rows are tracked and the source is a
+ * mapped page, only the rows that are nonblank in either page are
+ * copied; all of the others are blank in both.
+ */
 void dmd_copy_page (dmd_buffer_t dst, const dmd_buffer_t src)
 {
+	if (unlikely (dmd_dirty_owned_p ()))
+	{
+		dmd_pagenum_t dst_page = dmd_buffer_page (dst);
+		dmd_pagenum_t src_page = dmd_buffer_page (src);
+
+		if (dst_page < PINIO_NUM_DMD_PAGES && src_page < PINIO_NUM_DMD_PAGES)
+		{
+			U8 top = dmd_dirty_top[dst_page];
+			U8 bottom = dmd_dirty_bottom[dst_page];
+
+			if (dmd_dirty_top[src_page] < top)
+				top = dmd_dirty_top[src_page];
+			if (dmd_dirty_bottom[src_page] > bottom)
+				bottom = dmd_dirty_bottom[src_page];
+			dmd_dirty_top[dst_page] = dmd_dirty_top[src_page];
+			dmd_dirty_bottom[dst_page] = dmd_dirty_bottom[src_page];
+
+			if (top >= bottom)
+				return;
+			if (bottom - top < PINIO_DMD_HEIGHT)
+			{
+				__blockcopy16 (dst + (U16)top * DMD_BYTE_WIDTH,
+					src + (U16)top * DMD_BYTE_WIDTH,
+					(U16)(bottom - top) * DMD_BYTE_WIDTH);
+				return;
+			}
+		}
+		else
+		{
+			dmd_dirty_mark (dst, 0, PINIO_DMD_HEIGHT);
+		}
+	}
+
 #ifdef __m6809__
 	dmd_copy_asm (dst, src);
 #else
@@ -490,6 +691,10 @@ void dmd_do_transition (void)
 	dmd_trans_data_ptr = NULL;
 	dmd_trans_data_ptr2 = NULL;
 
+	/* The transition functions do not report what they draw */
+	if (unlikely (dmd_dirty_tracking))
+		dmd_dirty_all ();
+
 	page_push (TRANS_PAGE);
 
 	if (dmd_transition->composite_init)
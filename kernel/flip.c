@@ -190,12 +190,20 @@ void fliptronic_rtt (void)
 
 #ifdef MACHINE_HAS_UPPER_RIGHT_FLIPPER
 			flipper_service (WPC_UR_FLIP_SW, WPC_UR_FLIP_EOS, WPC_UR_FLIP_POWER, WPC_UR_FLIP_HOLD);
+#endif
+#ifdef CONFIG_SWITCH_LATENCY
+			/* Each button input is one bit above its power output;
+			leave out flippers that software is holding. */
+			switch_latency_flipper_rtt (flipper_outputs & ~(flipper_overrides >> 1));
 #endif
 			wpc_write_flippers (flipper_outputs);
 			return;
 		}
 	}
 
+#ifdef CONFIG_SWITCH_LATENCY
+	switch_latency_flipper_rtt (0);
+#endif
 	wpc_write_flippers (fliptronic_powered_coil_outputs);
 }
 
@@ -203,6 +203,42 @@ void (*font_blit_table[]) (U8 *) = {
 
 #endif /* !__m6809__ */
 
+#ifdef CONFIG_FONT_PRESHIFT
+
+extern const struct font_preshift font_preshift_table[];
+
+/** Return the pre-shifted glyph table for a font, or NULL if it
+ * has none.  The font page must be mapped. */
+static const U8 *const *font_preshift_lookup (const font_t *font)
+{
+	const struct font_preshift *ps;
+
+	for (ps = font_preshift_table; ps->font; ps++)
+		if (ps->font == font)
+			return ps->glyphs;
+	return NULL;
+}
+
+#ifndef __m6809__
+/** Draw a glyph that has already been shifted into position.
+ * Each row is copied as is; no shifting is required. */
+static void font_blit_preshifted (U8 *dst, const U8 *src)
+{
+	U8 row_bytes = *src++;
+	U8 n;
+
+	do
+	{
+		for (n = 0; n < row_bytes; n++)
+			wpc_dmd_addr_verify (dst)[n] ^= *src++;
+		dst += DMD_BYTE_WIDTH;
+	} while (likely (--font_height));
+}
+#endif
+
+#endif /* CONFIG_FONT_PRESHIFT */
+
+
 /** Renders a string whose characteristics have already been
  * computed.  font_args contains the font type, starting
  * coordinates (from the upper left), and pointer to the string
@@ -216,6 +252,10 @@ static void fontargs_render_string (void)
 #ifndef __m6809__
 	void (*blitter) (U8 *);
 #endif
+#ifdef CONFIG_FONT_PRESHIFT
+	const U8 *const *preshift;
+	const U8 *preshift_src;
+#endif
 
 	dmd_base = ((U8 *)dmd_low_buffer) + args->coord.y * DMD_BYTE_WIDTH;
 	s = sprintf_buffer;
@@ -227,7 +267,11 @@ static void fontargs_render_string (void)
 	 * there to be able to read the font data */
 	page_push (FONT_PAGE);
 
+	dmd_dirty_rows (dmd_low_buffer, args->coord.y, args->font->height);
 	top_space = 0;
+#ifdef CONFIG_FONT_PRESHIFT
+	preshift = font_preshift_lookup (args->font);
+#endif
 
 	/* Loop over every character in the string. */
 	while ((c = *s++) != '\0')
@@ -259,17 +303,35 @@ static void fontargs_render_string (void)
 		/* Set the starting address */
 		blit_dmd = wpc_dmd_addr_verify (dmd_base + args->coord.x / 8);
 
-		/* Write the character. */
+		/* Write the character.  Use the pre-shifted copy of the
+		glyph if there is one for this font and position. */
+#ifdef CONFIG_FONT_PRESHIFT
+		if (preshift
+			&& c >= FONT_PRESHIFT_FIRST && c <= FONT_PRESHIFT_LAST
+			&& (preshift_src = preshift[(c - FONT_PRESHIFT_FIRST) * 8
+				+ (args->coord.x & 0x7)]) != NULL)
+		{
+#ifdef __m6809__
+			bitmap_src = preshift_src;
+			bitmap_blit_preshifted_asm (blit_dmd);
+#else
+			font_blit_preshifted (blit_dmd, preshift_src);
+#endif
+		}
+		else
+#endif
 #ifdef __m6809__
 		bitmap_blit_asm (blit_dmd, args->coord.x & 0x7);
 #else
-		/* The glyph is drawn one row at a time. */
-		blitter = font_blit_table[args->coord.x & 0x7];
-		do
 		{
-			blitter (wpc_dmd_addr_verify (blit_dmd));
-			blit_dmd += DMD_BYTE_WIDTH;
-		} while (likely (--font_height)); /* end for each row */
+			/* The glyph is drawn one row at a time. */
+			blitter = font_blit_table[args->coord.x & 0x7];
+			do
+			{
+				blitter (wpc_dmd_addr_verify (blit_dmd));
+				blit_dmd += DMD_BYTE_WIDTH;
+			} while (likely (--font_height)); /* end for each row */
+		}
 #endif
 
 		/* advance by 1 char ... args->font->width */
@@ -307,6 +369,7 @@ void bitmap_blit (const U8 *src, U8 x, U8 y)
 	font_byte_width = (font_width + 7) >> 3;
 #endif
 	font_height = *src++;
+	dmd_dirty_rows (dmd_low_buffer, y, font_height);
 	blit_dmd = wpc_dmd_addr_verify (dmd_base + (x / 8));
 	bitmap_src = src;
 
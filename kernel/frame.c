@@ -87,6 +87,75 @@ void frame_decode_rle_c (U8 *data)
 		}
 	}
 }
+
+
+void frame_decode_sparse_c (U8 *data)
+{
+	U8 *dst = dmd_low_buffer;
+	U8 words;
+
+	dmd_clean_page (dmd_low_buffer);
+	while ((words = *data++) != 0)
+	{
+		dst += *data++;
+		do {
+			*dst++ = *data++;
+			*dst++ = *data++;
+		} while (--words != 0);
+	}
+}
+
+
+void frame_decode_lz_c (U8 *data)
+{
+	U8 *dst = dmd_low_buffer;
+	U8 token, offset;
+
+	while ((token = *data++) != 0)
+	{
+		if (token & 0x80)
+		{
+			/* Back-reference: copy (token & 0x7F) + 3 bytes
+			from OFFSET bytes earlier.  The source and destination
+			may overlap, so this must go a byte at a time. */
+			token = (token & 0x7F) + 3;
+			offset = *data++;
+			do {
+				*dst = dst[-offset];
+				dst++;
+			} while (--token != 0);
+		}
+		else
+		{
+			/* Literals */
+			do {
+				*dst++ = *data++;
+			} while (--token != 0);
+		}
+	}
+}
+
+
+void frame_decode_xor_c (U8 *data)
+{
+	U8 *dst = dmd_low_buffer;
+	U8 words, skip;
+
+	for (;;)
+	{
+		words = *data++;
+		skip = *data++;
+		if (words == 0 && skip == 0)
+			break;
+		dst += skip;
+		while (words != 0)
+		{
+			*dst++ ^= *data++;
+			*dst++ ^= *data++;
+			words--;
+		}
+	}
+}
 #endif
 
 
@@ -109,6 +178,23 @@ void frame_decode (U8 *data, U8 type)
 	{
 		frame_decode_sparse (data);
 	}
+	else if (type == 6)
+	{
+		frame_decode_lz (data);
+	}
+	else if (type == 8)
+	{
+		/* Only the differences from the first plane are stored.
+		That plane was just drawn and is now in the high window. */
+		dmd_copy_page (dmd_low_buffer, dmd_high_buffer);
+		frame_decode_xor (data);
+	}
+	else if (type == 10)
+	{
+		/* A delta against the frame two before in a stream,
+		which is still in this page.  See frame_stream_draw(). */
+		frame_decode_xor (data);
+	}
 }
 
 /**
@@ -136,11 +222,42 @@ void frame_draw_plane (U16 id)
 	pinio_set_bank (PINIO_BANK_ROM, p->page);
 	type = data[0];
 	frame_decode (data + 1, type & ~0x1);
+	dmd_dirty_rows (dmd_low_buffer, 0, PINIO_DMD_HEIGHT);
 
 	page_pop ();
 }
 
 
+/**
+ * Return the encoding type of one plane of a DMD frame.
+ */
+static U8 frame_plane_type (U16 id)
+{
+	U8 type;
+	struct frame_pointer *p;
+	U8 *data;
+
+	page_push (IMAGEMAP_PAGE);
+	p = (struct frame_pointer *)IMAGEMAP_BASE + id;
+	data = PTR(p);
+	pinio_set_bank (PINIO_BANK_ROM, p->page);
+	type = data[0];
+	page_pop ();
+	return type & ~0x1;
+}
+
+
+/**
+ * Return true if a frame belongs to a delta stream and cannot be
+ * drawn by itself, because one of its planes is stored as the
+ * changes from an earlier frame.
+ */
+bool frame_delta_p (U16 id)
+{
+	return frame_plane_type (id) == 10 || frame_plane_type (id + 1) == 10;
+}
+
+
 /**
  * Draw a 2-plane, 4-color DMD frame.
  * ID identifies the first plane of the frame.  The two
@@ -155,6 +272,45 @@ void frame_draw (U16 id)
 }
 
 
+/** The two page pairs that a frame stream alternates between */
+dmd_pagenum_t frame_stream_pages[2];
+
+/** Which of frame_stream_pages the next frame is drawn into */
+U8 frame_stream_next;
+
+
+/**
+ * Begin playing a delta stream: an animation that imgld has
+ * encoded with '%delta'.  Two page pairs are allocated, and the
+ * frames are drawn into each in turn, so that a page always holds
+ * the frame two before the one being drawn.  Those pages must not
+ * be reused until the stream is finished, so nothing else should
+ * allocate pages while it plays.
+ */
+void frame_stream_begin (void)
+{
+	dmd_alloc_pair ();
+	frame_stream_pages[0] = dmd_low_page;
+	dmd_alloc_pair ();
+	frame_stream_pages[1] = dmd_low_page;
+	frame_stream_next = 0;
+}
+
+
+/**
+ * Draw and show the next frame of a delta stream.  The frames must
+ * be drawn in order, starting from the first one; most of them only
+ * update the page rather than redraw it, which is much faster.
+ */
+void frame_stream_draw (U16 id)
+{
+	dmd_map_low_high (frame_stream_pages[frame_stream_next]);
+	frame_draw (id);
+	dmd_show2 ();
+	frame_stream_next ^= 1;
+}
+
+
 /**
  * Draw an arbitrary sized bitmap at a particular region
  * of the display.
@@ -47,6 +47,17 @@
  * A mask bit of 0 discards the previous state of the lamp, and allows the
  * new state, either 0 or 1 to come through.
  *
+ * This is not done on every scan, though.  Whenever one of the matrices
+ * changes, the column containing the change is marked dirty.  The IRQ
+ * keeps the last output for each column in lamp_output_matrix, and only
+ * recalculates a column when it is about to strobe it and finds it dirty.
+ * So a change is seen on the very next scan of its column, even before
+ * initialization is complete.  All changes to the lamp matrices must go
+ * through the lamp_ and leff_ functions below, or lamp_bit_on/
+ * lamp_bit_off/lamp_bit_toggle, which mark the columns dirty; any other
+ * writer must call lamp_mark_dirty() itself.  The plain bit_ functions are also used for
+ * the switch bitmaps and do not do this.
+ *
  * On top of this, the default state of a lamp can be set to 'flashing'.
  * A separate bit matrix tracks all lamps that are in flashing mode.
  * A separate realtime function, which runs much more slowly, toggles the
@@ -56,6 +67,14 @@
  * as setting them.  In simple cases, the default lamps can be used as
  * boolean variables for indicating game state.
  *
+ * When CONFIG_LAMP_LEVELS is set, lamps can also be given an intensity
+ * with lamp_set_level().  This uses bit angle modulation: the levels are
+ * kept as bit planes, and the IRQ shows plane N for 2^N complete matrix
+ * scans in turn, so a lamp at level 1 of 3 is lit during one scan out of
+ * every three.  The planes are combined with the lamp effects when a
+ * column is recalculated, so the IRQ just ORs in one more byte per
+ * column, and switches planes at the end of a scan.
+ *
  * Default lamp values are also tracked per-player.  They are guaranteed to be
  * all off at the start of a player's game, and they are saved/restored in
  * multiplayer games.  The secondary/lightshow values are transient and are not
@@ -79,10 +98,42 @@ __fastram__ U8 lamp_leff2_matrix[NUM_LAMP_COLS];
 
 __fastram__ U8 lamp_leff2_allocated[NUM_LAMP_COLS];
 
+/** The combined lamp outputs, as calculated from all of the above */
+__fastram__ U8 lamp_output_matrix[NUM_LAMP_COLS];
+
+/** The columns for which lamp_output_matrix is out-of-date */
+U8 lamp_dirty[BITS_TO_BYTES (NUM_LAMP_COLS)];
+
+/** The columns to recalculate because the flash rtt has toggled the
+ * flashing lamps.  Only the IRQ uses this. */
+__fastram__ U8 lamp_flash_dirty;
+
 U8 bit_matrix[BITS_TO_BYTES (MAX_FLAGS)];
 
 U8 global_bits[BITS_TO_BYTES (MAX_GLOBAL_FLAGS)];
 
+#ifdef CONFIG_LAMP_LEVELS
+/** The bit planes of the lamp levels.  Plane N holds the lamps whose
+ * level has bit N set.  There is one set of planes for each layer: the
+ * levels set by ordinary code, by shared leffs and by the exclusive
+ * leff. */
+U8 lamp_level_planes[LAMP_LEVEL_LAYERS][LAMP_LEVEL_BITS][NUM_LAMP_COLS];
+
+/** The planes of all layers, with the lamp effect allocations applied
+ * in the same way as for the lamp matrices.  This is what the IRQ
+ * ORs into the output. */
+U8 lamp_level_output[LAMP_LEVEL_BITS][NUM_LAMP_COLS];
+
+/** The plane of lamp_level_output shown during the current scan */
+__fastram__ U8 *lamp_level_plane;
+
+/** The weight of the current plane: the number of scans it is shown */
+__fastram__ U8 lamp_level_weight;
+
+/** The number of scans left before moving to the next plane */
+__fastram__ U8 lamp_level_hold;
+#endif
+
 __fastram__ U8 lamp_strobe_mask;
 
 __fastram__ U8 lamp_strobe_column;
@@ -106,12 +157,24 @@ void lamp_init (void)
 	matrix_all_off (bit_matrix);
 	matrix_all_off (global_bits);
 
+#ifdef CONFIG_LAMP_LEVELS
+	memset (lamp_level_planes, 0, sizeof (lamp_level_planes));
+	memset (lamp_level_output, 0, sizeof (lamp_level_output));
+	lamp_level_plane = lamp_level_output[0];
+	lamp_level_weight = lamp_level_hold = 1;
+#endif
+
 	/* Lamp effect allocation matrices are "backwards",
 	 * in the sense that a '1' means free, and '0' means
 	 * allocated. */
 	lamp_leff1_free_all ();
 	lamp_leff2_free_all ();
 
+	/* The IRQ calculates the real outputs on its first scan */
+	matrix_all_off (lamp_output_matrix);
+	lamp_mark_all_dirty ();
+	lamp_flash_dirty = 0;
+
 	lamp_strobe_mask = 0x1;
 	lamp_strobe_column = 0;
 	lamp_power_timer = 0;
@@ -132,7 +195,62 @@ void lamp_flash_rtt (void)
 	lamp_matrix_words[1] ^= lamp_flash_matrix_words[1];
 	lamp_matrix_words[2] ^= lamp_flash_matrix_words[2];
 	lamp_matrix_words[3] ^= lamp_flash_matrix_words[3];
+	lamp_flash_dirty = 0xFF;
+}
+
+
+/** Recalculate the output for a single lamp column. */
+static U8 lamp_compose (U8 col)
+{
+	U8 bits;
+
+	/* Grab the default lamp values */
+	bits = lamp_matrix[col];
+
+	/* OR in the flashing lamp values.  These are guaranteed to be
+	 * zero for any lamps where the flash is turned off.
+	 * Otherwise, these bits are periodically inverted by the
+	 * (slower) flash rtt function above.
+	 * This means that for the flash to work, the default bit
+	 * must be OFF when the flash bit is ON.  (Use the tristate
+	 * macros to ensure this.)
+	 */
+	bits |= lamp_flash_matrix_now[col];
+
+	/* Override with the lamp effect lamps.
+	 * Leff2 bits are low priority and used for long-running
+	 * lamp effects.  Leff1 is higher priority and used
+	 * for quick effects.  Therefore leff2 is applied first,
+	 * and leff1 may override it.
+	 */
+	bits &= lamp_leff2_allocated[col];
+	bits |= lamp_leff2_matrix[col];
+	bits &= lamp_leff1_allocated[col];
+	bits |= lamp_leff1_matrix[col];
+	return bits;
+}
+
+
+#ifdef CONFIG_LAMP_LEVELS
+/** Recalculate the level outputs for a single lamp column.  Each
+ * layer of levels is treated like the lamp matrix of the same layer,
+ * so a lamp effect can dim or turn off a lamp that has a level. */
+static void lamp_level_compose (U8 col)
+{
+	U8 plane;
+	U8 bits;
+
+	for (plane = 0; plane < LAMP_LEVEL_BITS; plane++)
+	{
+		bits = lamp_level_planes[LAMP_LEVEL_BASE][plane][col];
+		bits &= lamp_leff2_allocated[col];
+		bits |= lamp_level_planes[LAMP_LEVEL_LEFF2][plane][col];
+		bits &= lamp_leff1_allocated[col];
+		bits |= lamp_level_planes[LAMP_LEVEL_LEFF1][plane][col];
+		lamp_level_output[plane][col] = bits;
+	}
 }
+#endif
 
 
 /** Runs periodically to update the physical lamp state. */
@@ -167,35 +285,28 @@ void lamp_rtt (void)
 		return;
 	}
 
-	/* Grab the default lamp values */
-	bits = lamp_matrix[lamp_strobe_column];
-
-	/* OR in the flashing lamp values.  These are guaranteed to be
-	 * zero for any lamps where the flash is turned off.
-	 * Otherwise, these bits are periodically inverted by the
-	 * (slower) flash rtt function above.
-	 * This means that for the flash to work, the default bit
-	 * must be OFF when the flash bit is ON.  (Use the tristate
-	 * macros to ensure this.)
-	 */
-	bits |= lamp_flash_matrix_now[lamp_strobe_column];
+	/* Recalculate this column if it has changed since it was last
+	strobed.  Tasks only ever set bits in lamp_dirty, so if one is in
+	the middle of doing that, clearing a bit here can at worst cause
+	one extra recalculation. */
+	if (unlikely ((lamp_dirty[0] | lamp_flash_dirty) & lamp_strobe_mask))
+	{
+		lamp_dirty[0] &= ~lamp_strobe_mask;
+		lamp_flash_dirty &= ~lamp_strobe_mask;
+		lamp_output_matrix[lamp_strobe_column] = lamp_compose (lamp_strobe_column);
+#ifdef CONFIG_LAMP_LEVELS
+		lamp_level_compose (lamp_strobe_column);
+#endif
+	}
 
-	/* TODO : implement lamp strobing, like the newer Stern games
-	do.  Implement like DMD page flipping, alternating between 2
-	different lamp matrices rapidly to present 4 different
-	intensities.  A background task, like the flash_rtt above,
-	would toggle the intensities at a slower rate. */
+	/* Grab the precalculated lamp values */
+	bits = lamp_output_matrix[lamp_strobe_column];
 
-	/* Override with the lamp effect lamps.
-	 * Leff2 bits are low priority and used for long-running
-	 * lamp effects.  Leff1 is higher priority and used
-	 * for quick effects.  Therefore leff2 is applied first,
-	 * and leff1 may override it.
-	 */
-	bits &= lamp_leff2_allocated[lamp_strobe_column];
-	bits |= lamp_leff2_matrix[lamp_strobe_column];
-	bits &= lamp_leff1_allocated[lamp_strobe_column];
-	bits |= lamp_leff1_matrix[lamp_strobe_column];
+#ifdef CONFIG_LAMP_LEVELS
+	/* OR in the lamps that have an intensity level and are lit
+	during this scan. */
+	bits |= lamp_level_plane[lamp_strobe_column];
+#endif
 
 	/* Write the result to the hardware */
 	pinio_write_lamp_data (bits);
@@ -213,6 +324,23 @@ void lamp_rtt (void)
 
 		/* After strobing all lamps, reload the power saver timer */
 		lamp_power_timer = lamp_power_level;
+
+#ifdef CONFIG_LAMP_LEVELS
+		/* Once the current plane has been shown for as many scans as
+		its weight, move on to the next one, which has twice the
+		weight. */
+		if (--lamp_level_hold == 0)
+		{
+			lamp_level_plane += NUM_LAMP_COLS;
+			lamp_level_weight <<= 1;
+			if (lamp_level_plane == lamp_level_output[LAMP_LEVEL_BITS])
+			{
+				lamp_level_plane = lamp_level_output[0];
+				lamp_level_weight = 1;
+			}
+			lamp_level_hold = lamp_level_weight;
+		}
+#endif
 	}
 	else
 	{
@@ -312,6 +440,29 @@ void matrix_all_off (bitset matrix)
 }
 
 
+/* The same as bit_on/bit_off/bit_toggle, but for one of the lamp
+matrices that feed the lamp outputs.  The column is marked so that
+its output is recalculated. */
+
+void lamp_bit_on (bitset matrix, lampnum_t lamp)
+{
+	bitarray_set (matrix, lamp);
+	lamp_mark_dirty (lamp);
+}
+
+void lamp_bit_off (bitset matrix, lampnum_t lamp)
+{
+	bitarray_clear (matrix, lamp);
+	lamp_mark_dirty (lamp);
+}
+
+void lamp_bit_toggle (bitset matrix, lampnum_t lamp)
+{
+	bitarray_toggle (matrix, lamp);
+	lamp_mark_dirty (lamp);
+}
+
+
 /*
  * Lamp manipulation routines
  *
@@ -322,17 +473,17 @@ void matrix_all_off (bitset matrix)
  */
 void lamp_on (lampnum_t lamp)
 {
-	bit_on (lamp_matrix, lamp);
+	lamp_bit_on (lamp_matrix, lamp);
 }
 
 void lamp_off (lampnum_t lamp)
 {
-	bit_off (lamp_matrix, lamp);
+	lamp_bit_off (lamp_matrix, lamp);
 }
 
 void lamp_toggle (lampnum_t lamp)
 {
-	bit_toggle (lamp_matrix, lamp);
+	lamp_bit_toggle (lamp_matrix, lamp);
 }
 
 bool lamp_test (lampnum_t lamp)
@@ -361,7 +512,7 @@ void lamp_flash_on (lampnum_t lamp)
 	if (!bit_test (lamp_flash_matrix, lamp))
 	{
 		/* Enable flashing on this lamp */
-		bit_on (lamp_flash_matrix, lamp);
+		lamp_bit_on (lamp_flash_matrix, lamp);
 
 		/* Set the initial flash state of the lamp to match that of all
 		other lamps that are flashing.  If any of the flashing lamps
@@ -369,17 +520,17 @@ void lamp_flash_on (lampnum_t lamp)
 		it off. */
 		disable_interrupts ();
 		if (!bit_test_all_off (lamp_flash_matrix_now))
-			bit_on (lamp_flash_matrix_now, lamp);
+			lamp_bit_on (lamp_flash_matrix_now, lamp);
 		else
-			bit_off (lamp_flash_matrix_now, lamp);
+			lamp_bit_off (lamp_flash_matrix_now, lamp);
 		enable_interrupts ();
 	}
 }
 
 void lamp_flash_off (lampnum_t lamp)
 {
-	bit_off (lamp_flash_matrix, lamp);
-	bit_off (lamp_flash_matrix_now, lamp);
+	lamp_bit_off (lamp_flash_matrix, lamp);
+	lamp_bit_off (lamp_flash_matrix_now, lamp);
 }
 
 bool lamp_flash_test (lampnum_t lamp)
@@ -388,6 +539,91 @@ bool lamp_flash_test (lampnum_t lamp)
 }
 
 
+#ifdef CONFIG_LAMP_LEVELS
+/** Return the layer of levels that the current task writes to.  Lamp
+ * effects have their own layers, which are cleared along with their
+ * lamp matrices when they stop. */
+static U8 lamp_level_layer (void)
+{
+	if (task_getgid () == GID_LEFF)
+		return LAMP_LEVEL_LEFF1;
+	else if (task_getgid () == GID_SHARED_LEFF)
+		return LAMP_LEVEL_LEFF2;
+	else
+		return LAMP_LEVEL_BASE;
+}
+
+
+/** Set the level of a lamp in one layer */
+static void lamp_level_write (U8 layer, lampnum_t lamp, U8 level)
+{
+	U8 plane;
+
+	/* The IRQ only reads these planes when it recalculates a dirty
+	column, and each bit is a single byte write, so this is safe to do
+	without disabling interrupts.  The level may be a mix of old and
+	new bits until the column is marked dirty below. */
+	for (plane = 0; plane < LAMP_LEVEL_BITS; plane++)
+	{
+		if (level & (1 << plane))
+			bit_on (lamp_level_planes[layer][plane], lamp);
+		else
+			bit_off (lamp_level_planes[layer][plane], lamp);
+	}
+	lamp_mark_dirty (lamp);
+}
+
+
+/** Clear all of the levels in one layer */
+static void lamp_level_erase (U8 layer)
+{
+	memset (lamp_level_planes[layer], 0, sizeof (lamp_level_planes[layer]));
+	lamp_mark_all_dirty ();
+}
+
+
+/**
+ * Set the intensity of a lamp, from 0 (off) to LAMP_LEVEL_MAX (fully
+ * on).  Larger values are treated as fully on.  This may be called
+ * from a lamp effect; its levels only apply to the lamps that it has
+ * allocated, and are cleared when it exits or is stopped.
+ */
+void lamp_set_level (lampnum_t lamp, U8 level)
+{
+	if (level > LAMP_LEVEL_MAX)
+		level = LAMP_LEVEL_MAX;
+	lamp_level_write (lamp_level_layer (), lamp, level);
+}
+
+
+/**
+ * Return the current intensity of a lamp, as set by lamp_set_level()
+ * from the same kind of caller.  A lamp that is on by other means
+ * reads as 0.
+ */
+U8 lamp_get_level (lampnum_t lamp)
+{
+	U8 plane;
+	U8 layer = lamp_level_layer ();
+	U8 level = 0;
+
+	for (plane = 0; plane < LAMP_LEVEL_BITS; plane++)
+		if (bit_test (lamp_level_planes[layer][plane], lamp))
+			level |= 1 << plane;
+	return level;
+}
+
+
+/** Set the intensity of all lamps to zero. */
+void lamp_level_all_off (void)
+{
+	lamp_level_erase (LAMP_LEVEL_BASE);
+	lamp_level_erase (LAMP_LEVEL_LEFF2);
+	lamp_level_erase (LAMP_LEVEL_LEFF1);
+}
+#endif /* CONFIG_LAMP_LEVELS */
+
+
 /*
  * lamp_all_on / lamp_all_off are optimized and should be used
  * if all lamps are affected, rather than setting them one at
@@ -400,6 +636,7 @@ void lamp_all_on (void)
 	matrix_all_off (lamp_flash_matrix);
 	enable_interrupts ();
 	matrix_all_on (lamp_matrix);
+	lamp_mark_all_dirty ();
 }
 
 
@@ -412,6 +649,10 @@ void lamp_all_off (void)
 	matrix_all_off (lamp_leff2_matrix);
 	enable_interrupts ();
 	matrix_all_off (lamp_matrix);
+	lamp_mark_all_dirty ();
+#ifdef CONFIG_LAMP_LEVELS
+	lamp_level_all_off ();
+#endif
 }
 
 /*
@@ -427,43 +668,57 @@ void lamp_all_off (void)
 void lamp_leff1_allocate_all (void)
 {
 	matrix_all_off (lamp_leff1_allocated);
+	lamp_mark_all_dirty ();
 }
 
 void lamp_leff1_erase (void)
 {
 	matrix_all_off (lamp_leff1_matrix);
+#ifdef CONFIG_LAMP_LEVELS
+	lamp_level_erase (LAMP_LEVEL_LEFF1);
+#endif
+	lamp_mark_all_dirty ();
 }
 
 void lamp_leff1_free_all (void)
 {	
 	matrix_all_on (lamp_leff1_allocated);
+	lamp_mark_all_dirty ();
 }
 
 void lamp_leff2_erase (void)
 {
 	matrix_all_off (lamp_leff2_matrix);
+#ifdef CONFIG_LAMP_LEVELS
+	lamp_level_erase (LAMP_LEVEL_LEFF2);
+#endif
+	lamp_mark_all_dirty ();
 }
 
 void lamp_leff2_free_all (void)
 {
 	matrix_all_on (lamp_leff2_allocated);
+	lamp_mark_all_dirty ();
 }
 
 
 void lamp_leff_allocate (lampnum_t lamp)
 {
-	bit_off (lamp_leff1_allocated, lamp);
+	lamp_bit_off (lamp_leff1_allocated, lamp);
 }
 
 void lamp_leff_free (lampnum_t lamp)
 {
-	bit_on (lamp_leff1_allocated, lamp);
+	lamp_bit_on (lamp_leff1_allocated, lamp);
 }
 
 void lamp_leff2_allocate (lampnum_t lamp)
 {
-	bit_off (lamp_leff2_matrix, lamp);
-	bit_off (lamp_leff2_allocated, lamp);
+	lamp_bit_off (lamp_leff2_matrix, lamp);
+	lamp_bit_off (lamp_leff2_allocated, lamp);
+#ifdef CONFIG_LAMP_LEVELS
+	lamp_level_write (LAMP_LEVEL_LEFF2, lamp, 0);
+#endif
 }
 
 bool lamp_leff2_test_and_allocate (lampnum_t lamp)
@@ -480,8 +735,11 @@ bool lamp_leff2_test_and_allocate (lampnum_t lamp)
 
 void lamp_leff2_free (lampnum_t lamp)
 {
-	bit_on (lamp_leff2_allocated, lamp);
-	bit_off (lamp_leff2_matrix, lamp);
+	lamp_bit_on (lamp_leff2_allocated, lamp);
+	lamp_bit_off (lamp_leff2_matrix, lamp);
+#ifdef CONFIG_LAMP_LEVELS
+	lamp_level_write (LAMP_LEVEL_LEFF2, lamp, 0);
+#endif
 }
 
 /*
@@ -498,7 +756,7 @@ void leff_on (lampnum_t lamp)
 {
 	register bitset p = (leff_running_flags & L_SHARED) ?
 		lamp_leff2_matrix : lamp_leff1_matrix;
-	bit_on (p, lamp);
+	lamp_bit_on (p, lamp);
 }
 
 
@@ -506,7 +764,7 @@ void leff_off (lampnum_t lamp)
 {
 	register bitset p = (leff_running_flags & L_SHARED) ?
 		lamp_leff2_matrix : lamp_leff1_matrix;
-	bit_off (p, lamp);
+	lamp_bit_off (p, lamp);
 }
 
 
@@ -514,7 +772,7 @@ void leff_toggle (lampnum_t lamp)
 {
 	register bitset p = (leff_running_flags & L_SHARED) ?
 		lamp_leff2_matrix : lamp_leff1_matrix;
-	bit_toggle (p, lamp);
+	lamp_bit_toggle (p, lamp);
 }
 
 
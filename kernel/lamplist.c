@@ -40,6 +40,13 @@
  * value LAMP_END.  Within a lamplist you can also encode "breaks",
  * which separate one lamplist into multiple sections.  This allows
  * an additional delay to be applied.
+ *
+ * genmachine also emits every lamplist as a bitmap laid out like the
+ * lamp matrix, in lamplist_mask_table.  When the order of the lamps does
+ * not matter, the lamplist_mask functions use it to change or test the
+ * whole list a byte at a time.  When not called from a lamp effect,
+ * lamplist_apply uses it for on, off and flash off, and
+ * lamplist_test_all/any use it for the common tests.
  */
 
 #include <freewpc.h>
@@ -47,6 +54,9 @@
 /** A table of pointers to all of the defined lamplists */
 extern const lampnum_t *lamplist_table[];
 
+/** A table of the same lamplists, as bitmaps */
+extern const U8 lamplist_mask_table[][NUM_LAMP_COLS];
+
 
 U8 lamplist_alternation_state;
 
@@ -144,6 +154,101 @@ static void lamplist_leff_sleep (U8 delay)
 }
 
 
+/** Turn on all lamps of a lamplist in a lamp matrix. */
+void lamplist_mask_on (lamplist_id_t id, bitset matrix)
+{
+	register const U8 *mask;
+	U8 col;
+
+	page_push (MD_PAGE);
+	mask = lamplist_mask_table[id];
+	for (col = 0; col < NUM_LAMP_COLS; col++)
+		if (mask[col])
+		{
+			matrix[col] |= mask[col];
+			bitarray_set (lamp_dirty, col);
+		}
+	page_pop ();
+}
+
+
+/** Turn off all lamps of a lamplist in a lamp matrix. */
+void lamplist_mask_off (lamplist_id_t id, bitset matrix)
+{
+	register const U8 *mask;
+	U8 col;
+
+	page_push (MD_PAGE);
+	mask = lamplist_mask_table[id];
+	for (col = 0; col < NUM_LAMP_COLS; col++)
+		if (mask[col])
+		{
+			matrix[col] &= ~mask[col];
+			bitarray_set (lamp_dirty, col);
+		}
+	page_pop ();
+}
+
+
+/** Toggle all lamps of a lamplist in a lamp matrix.  A lamp that
+ * appears more than once in the list is toggled only once. */
+void lamplist_mask_toggle (lamplist_id_t id, bitset matrix)
+{
+	register const U8 *mask;
+	U8 col;
+
+	page_push (MD_PAGE);
+	mask = lamplist_mask_table[id];
+	for (col = 0; col < NUM_LAMP_COLS; col++)
+		if (mask[col])
+		{
+			matrix[col] ^= mask[col];
+			bitarray_set (lamp_dirty, col);
+		}
+	page_pop ();
+}
+
+
+/** Returns true if all lamps of a lamplist are set in a lamp matrix. */
+bool lamplist_mask_test_all (lamplist_id_t id, const_bitset matrix)
+{
+	register const U8 *mask;
+	U8 col;
+	bool result = TRUE;
+
+	page_push (MD_PAGE);
+	mask = lamplist_mask_table[id];
+	for (col = 0; col < NUM_LAMP_COLS; col++)
+		if ((matrix[col] & mask[col]) != mask[col])
+		{
+			result = FALSE;
+			break;
+		}
+	page_pop ();
+	return result;
+}
+
+
+/** Returns true if any lamp of a lamplist is set in a lamp matrix. */
+bool lamplist_mask_test_any (lamplist_id_t id, const_bitset matrix)
+{
+	register const U8 *mask;
+	U8 col;
+	bool result = FALSE;
+
+	page_push (MD_PAGE);
+	mask = lamplist_mask_table[id];
+	for (col = 0; col < NUM_LAMP_COLS; col++)
+		if (matrix[col] & mask[col])
+		{
+			result = TRUE;
+			break;
+		}
+	page_pop ();
+	return result;
+}
+
+
 /** Apply an operator to each element of a lamplist, without executing
 any lamp macros. */
 void lamplist_apply_nomacro (lamplist_id_t id, lamp_operator_t op)
@@ -164,6 +269,31 @@ void lamplist_apply (lamplist_id_t id, lamp_operator_t op)
 	register const lampnum_t *entry;
 	U8 lamplist_apply_delay1 = 0;
 
+	/* Outside of a lamp effect, there are no delays, so the order
+	does not matter and the common operators can be done on the
+	whole list at once.  Toggle is not one of them: a lamp that
+	appears twice in the list is toggled twice, which the bitmap
+	cannot express. */
+	if (!leff_caller_p ())
+	{
+		if (op == lamp_on)
+		{
+			lamplist_mask_on (id, lamp_matrix);
+			return;
+		}
+		else if (op == lamp_off)
+		{
+			lamplist_mask_off (id, lamp_matrix);
+			return;
+		}
+		else if (op == lamp_flash_off)
+		{
+			lamplist_mask_off (id, lamp_flash_matrix);
+			lamplist_mask_off (id, lamp_flash_matrix_now);
+			return;
+		}
+	}
+
 	page_push (MD_PAGE);
 
 	for (entry = lamplist_table[id]; *entry != LAMP_END; entry++)
@@ -221,6 +351,11 @@ bool lamplist_test_all (lamplist_id_t id, lamp_boolean_operator_t op)
 	register const lampnum_t *entry;
 	bool result = TRUE;
 
+	if (op == lamp_test)
+		return lamplist_mask_test_all (id, lamp_matrix);
+	else if (op == lamp_flash_test)
+		return lamplist_mask_test_all (id, lamp_flash_matrix);
+
 	page_push (MD_PAGE);
 
 	for (entry = lamplist_table[id]; *entry != LAMP_END; entry++)
@@ -247,6 +382,11 @@ bool lamplist_test_any (lamplist_id_t id, lamp_boolean_operator_t op)
 	register const lampnum_t *entry;
 	bool result = FALSE;
 
+	if (op == lamp_test)
+		return lamplist_mask_test_any (id, lamp_matrix);
+	else if (op == lamp_flash_test)
+		return lamplist_mask_test_any (id, lamp_flash_matrix);
+
 	page_push (MD_PAGE);
 
 	for (entry = lamplist_table[id]; *entry != LAMP_END; entry++)
@@ -319,16 +459,16 @@ void lamplist_step_increment (lamplist_id_t set, bitset matrix)
 	if (bit_test_all_off (matrix))
 	{
 		entry = lamplist_first_entry (set);
-		bit_on (matrix, *entry);
+		lamp_bit_on (matrix, *entry);
 	}
 	else
 	{
 		entry = lamplist_find (set, matrix_test_operator (matrix));
-		bit_off (matrix, *entry);
+		lamp_bit_off (matrix, *entry);
 		entry = lamplist_next_entry (set, entry);
 		if (*entry == LAMP_END)
 			entry = lamplist_first_entry (set);
-		bit_on (matrix, *entry);
+		lamp_bit_on (matrix, *entry);
 	}
 	page_pop ();
 	lamplist_leff_sleep (lamplist_apply_delay);
@@ -380,7 +520,7 @@ void lamplist_build_increment (lamplist_id_t set, bitset matrix)
 			continue;
 		if (!((matrix_test_operator (matrix)) (*entry)))
 		{
-			bit_on (matrix, *entry);
+			lamp_bit_on (matrix, *entry);
 			break;
 		}
 	}
@@ -402,7 +542,7 @@ void lamplist_build_decrement (lamplist_id_t set, bitset matrix)
 			continue;
 		if (((matrix_test_operator (matrix)) (*entry)))
 		{
-			bit_off (matrix, *entry);
+			lamp_bit_off (matrix, *entry);
 			break;
 		}
 	}
@@ -438,7 +578,7 @@ void lamplist_rotate_next (lamplist_id_t set, bitset matrix)
 		if (lamp_macro (*entry))
 			continue;
 		newstate = test (*entry);
-		(state ? bit_on : bit_off) (matrix, *entry);
+		(state ? lamp_bit_on : lamp_bit_off) (matrix, *entry);
 		state = newstate;
 	}
 	page_pop ();
@@ -469,12 +609,12 @@ void lamplist_rotate_previous (lamplist_id_t set, bitset matrix)
 		if (prev_entry)
 		{
 			state = test (*entry);
-			(state ? bit_on : bit_off) (matrix, *prev_entry);
+			(state ? lamp_bit_on : lamp_bit_off) (matrix, *prev_entry);
 		}
 		prev_entry = entry;
 	}
 
-	(first ? bit_on : bit_off) (matrix, *prev_entry);
+	(first ? lamp_bit_on : lamp_bit_off) (matrix, *prev_entry);
 
 	page_pop ();
 	lamplist_leff_sleep (lamplist_apply_delay);
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * \file
+ * \brief Table-driven lamp effects
+ *
+ * A lamp show is a lamp effect that is described by a table of frames
+ * instead of by code.  The tables are compiled by tools/lampshow from
+ * the machine's .lsh files, and live in the machine description page
+ * alongside the lamplists.
+ *
+ * All running shows are played by a single task, so many of them can
+ * run at once without using up the task table.  Each show allocates its
+ * lamps in the same way as a shared leff, and draws into the
+ * lamp_leff2_matrix.  A show that cannot get all of its lamps waits
+ * for them: a looping show waits until it is stopped, and any other
+ * show gives up after LAMPSHOW_RETRY_TIME.
+ *
+ * leff_stop_all() frees every shared lamp.  Looping shows usually go
+ * with a game mode, which is still running, so they are put back into
+ * the waiting state and pick up their lamps again; shows that play once
+ * are dropped like any other lamp effect.
+ *
+ * Each frame in a table lists the lamps that change from the previous
+ * frame, so applying a frame is just a few bit toggles.
+ */
+
+#include <freewpc.h>
+
+/** The compiled shows, indexed by lampshow_id_t */
+extern const U8 * const lampshow_table[];
+
+extern __fastram__ U8 lamp_leff2_matrix[NUM_LAMP_COLS];
+
+/** How long a show that plays once waits for its lamps, in ticks */
+#define LAMPSHOW_RETRY_TIME TIME_1S
+
+/** The state of a running show */
+struct lampshow_slot
+{
+	/** The next frame to be applied, or NULL if the slot is free */
+	const U8 *pos;
+
+	/** The number of ticks until the next frame.  While waiting for
+	 * lamps, the number of ticks left to wait, or 0 to wait forever. */
+	U8 timer;
+
+	/** Nonzero if the show has not got its lamps yet */
+	U8 waiting;
+
+	/** Which show is running */
+	lampshow_id_t id;
+};
+
+struct lampshow_slot lampshow_slots[MAX_RUNNING_LAMPSHOWS];
+
+
+/** Return the first frame of a show.  It follows the flags byte and
+ * the list of lamps to allocate. */
+static inline const U8 *lampshow_first_frame (const U8 *show)
+{
+	return show + 2 + show[1];
+}
+
+
+/** Allocate all of the lamps used by a show, or none of them.
+ * Returns TRUE if they were allocated.  The caller must have the
+ * machine page mapped. */
+static bool lampshow_allocate (const U8 *show)
+{
+	U8 n;
+
+	for (n = 0; n < show[1]; n++)
+	{
+		if (!lamp_leff2_test_and_allocate (show[2 + n]))
+		{
+			while (n > 0)
+				lamp_leff2_free (show[2 + --n]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+/** Free the lamps used by a show and release its slot.
+ * The caller must have the machine page mapped. */
+static void lampshow_release (struct lampshow_slot *s)
+{
+	const U8 *show = lampshow_table[s->id];
+	U8 n;
+
+	if (!s->waiting)
+		for (n = 0; n < show[1]; n++)
+			lamp_leff2_free (show[2 + n]);
+	s->pos = NULL;
+}
+
+
+/** Put a show into the waiting state, to be started from its first
+ * frame once its lamps are free.  The caller must have the machine
+ * page mapped. */
+static void lampshow_wait (struct lampshow_slot *s)
+{
+	const U8 *show = lampshow_table[s->id];
+
+	s->pos = lampshow_first_frame (show);
+	s->waiting = TRUE;
+	s->timer = (show[0] & LAMPSHOW_LOOP) ? 0 : LAMPSHOW_RETRY_TIME;
+}
+
+
+/** Apply frames to a running show, until one is reached that has
+ * a nonzero delay.  The caller must have the machine page mapped. */
+static void lampshow_advance (struct lampshow_slot *s)
+{
+	const U8 *pos = s->pos;
+	U8 count;
+
+	for (;;)
+	{
+		count = *pos++;
+		if (count == LAMPSHOW_END)
+		{
+			const U8 *show = lampshow_table[s->id];
+			if (!(show[0] & LAMPSHOW_LOOP))
+			{
+				lampshow_release (s);
+				return;
+			}
+			pos = lampshow_first_frame (show);
+			continue;
+		}
+
+		while (count-- > 0)
+			lamp_bit_toggle (lamp_leff2_matrix, *pos++);
+
+		s->timer = *pos++;
+		if (s->timer != 0)
+			break;
+	}
+	s->pos = pos;
+}
+
+
+/** Try again to get the lamps for a waiting show, and start it if
+ * they are free.  The caller must have the machine page mapped. */
+static void lampshow_retry (struct lampshow_slot *s)
+{
+	if (lampshow_allocate (lampshow_table[s->id]))
+	{
+		s->waiting = FALSE;
+		lampshow_advance (s);
+	}
+	else if (s->timer != 0 && --s->timer == 0)
+	{
+		dbprintf ("lampshow %d: lamps busy, not started\n", s->id);
+		s->pos = NULL;
+	}
+}
+
+
+/** The task that plays all of the running shows, and starts the
+ * waiting ones once their lamps are free.  It exits when there are
+ * none left. */
+void lampshow_task (void)
+{
+	struct lampshow_slot *s;
+	bool active;
+
+	do {
+		task_sleep (TIME_16MS);
+		active = FALSE;
+		page_push (MD_PAGE);
+		for (s = lampshow_slots; s < lampshow_slots + MAX_RUNNING_LAMPSHOWS; s++)
+		{
+			if (s->pos)
+			{
+				if (s->waiting)
+					lampshow_retry (s);
+				else if (--s->timer == 0)
+					lampshow_advance (s);
+				if (s->pos)
+					active = TRUE;
+			}
+		}
+		page_pop ();
+	} while (active);
+	task_exit ();
+}
+
+
+/** Start a lamp show.  Nothing happens if the show is already
+ * running.  If any of its lamps are in use by another effect, the
+ * show waits for them. */
+void lampshow_start (lampshow_id_t id)
+{
+	struct lampshow_slot *s;
+	struct lampshow_slot *slot = NULL;
+
+	for (s = lampshow_slots; s < lampshow_slots + MAX_RUNNING_LAMPSHOWS; s++)
+	{
+		if (s->pos && s->id == id)
+			return;
+		if (!s->pos && !slot)
+			slot = s;
+	}
+	if (!slot)
+	{
+		dbprintf ("no slot for lampshow %d\n", id);
+		return;
+	}
+
+	page_push (MD_PAGE);
+	slot->id = id;
+	lampshow_wait (slot);
+	if (!lampshow_allocate (lampshow_table[id]))
+		dbprintf ("lampshow %d: waiting for lamps\n", id);
+	else
+	{
+		slot->waiting = FALSE;
+		lampshow_advance (slot);
+	}
+	page_pop ();
+
+	/* The shows outlive the ball, so the task that plays them must
+	too. */
+	task_create_gid1_while (GID_LAMPSHOW, lampshow_task, TASK_DURATION_INF);
+}
+
+
+/** Stop a lamp show, if it is running.  Its lamps are freed. */
+void lampshow_stop (lampshow_id_t id)
+{
+	struct lampshow_slot *s;
+
+	page_push (MD_PAGE);
+	for (s = lampshow_slots; s < lampshow_slots + MAX_RUNNING_LAMPSHOWS; s++)
+		if (s->pos && s->id == id)
+			lampshow_release (s);
+	page_pop ();
+}
+
+
+/** Return true if a lamp show is running */
+bool lampshow_running_p (lampshow_id_t id)
+{
+	struct lampshow_slot *s;
+
+	for (s = lampshow_slots; s < lampshow_slots + MAX_RUNNING_LAMPSHOWS; s++)
+		if (s->pos && s->id == id)
+			return TRUE;
+	return FALSE;
+}
+
+
+/** Called from leff_stop_all(), which frees all of the shared lamps.
+ * Looping shows wait to get their lamps back, and the others stop. */
+void lampshow_leff_stop_all (void)
+{
+	struct lampshow_slot *s;
+
+	page_push (MD_PAGE);
+	for (s = lampshow_slots; s < lampshow_slots + MAX_RUNNING_LAMPSHOWS; s++)
+		if (s->pos)
+		{
+			if (lampshow_table[s->id][0] & LAMPSHOW_LOOP)
+				lampshow_wait (s);
+			else
+				s->pos = NULL;
+		}
+	page_pop ();
+}
+
+
+/** Stop all lamp shows */
+void lampshow_stop_all (void)
+{
+	struct lampshow_slot *s;
+
+	task_kill_gid (GID_LAMPSHOW);
+	page_push (MD_PAGE);
+	for (s = lampshow_slots; s < lampshow_slots + MAX_RUNNING_LAMPSHOWS; s++)
+		if (s->pos)
+			lampshow_release (s);
+	page_pop ();
+}
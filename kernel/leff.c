@@ -89,6 +89,20 @@ U8 leff_prio;
  * otherwise. */
 U8 leffs_running[BITS_TO_BYTES (MAX_LEFFS)];
 
+#define MAX_QUEUED_LEFFS 8
+
+/** The exclusive, long-running leffs that have been started, ordered
+ * by priority, highest first.  Leffs of equal priority are ordered by
+ * ID.  The first entry is the one to run when no lightshow has
+ * the lamps. */
+leffnum_t leff_queue[MAX_QUEUED_LEFFS];
+
+/** The number of entries in leff_queue */
+U8 leff_queue_count;
+
+/** The number of leffs dropped because the queue was full */
+U16 leff_queue_overflows;
+
 
 /** Test if a lamp effect is running. */
 bool leff_running_p (leffnum_t dn)
@@ -97,6 +111,69 @@ bool leff_running_p (leffnum_t dn)
 }
 
 
+/** Drop a leff that does not fit in the queue.  It is no longer
+ * considered running and will not be restarted. */
+static void leff_queue_drop (leffnum_t dn)
+{
+	dbprintf ("Leff queue full, dropping %d\n", dn);
+	leff_queue_overflows++;
+	bitarray_clear (leffs_running, dn);
+}
+
+
+/** Add a long-running exclusive leff to the priority queue.
+ * If the queue is full, the lowest priority entry is dropped, and
+ * it is no longer considered running. */
+static void leff_queue_add (leffnum_t dn)
+{
+	U8 prio = leff_table[dn].prio;
+	U8 pos;
+	U8 n;
+
+	pos = leff_queue_count;
+	while (pos > 0)
+	{
+		leffnum_t prev = leff_queue[pos-1];
+		if (leff_table[prev].prio > prio
+			|| (leff_table[prev].prio == prio && prev < dn))
+			break;
+		pos--;
+	}
+
+	if (leff_queue_count == MAX_QUEUED_LEFFS)
+	{
+		if (pos == MAX_QUEUED_LEFFS)
+		{
+			leff_queue_drop (dn);
+			return;
+		}
+		leff_queue_count--;
+		leff_queue_drop (leff_queue[leff_queue_count]);
+	}
+
+	for (n = leff_queue_count; n > pos; n--)
+		leff_queue[n] = leff_queue[n-1];
+	leff_queue[pos] = dn;
+	leff_queue_count++;
+}
+
+
+/** Remove a leff from the priority queue, if it is there. */
+static void leff_queue_remove (leffnum_t dn)
+{
+	U8 pos;
+
+	for (pos = 0; pos < leff_queue_count; pos++)
+		if (leff_queue[pos] == dn)
+		{
+			leff_queue_count--;
+			for (; pos < leff_queue_count; pos++)
+				leff_queue[pos] = leff_queue[pos+1];
+			return;
+		}
+}
+
+
 /** Returns the ID of the highest priority exclusive lamp effect
  * still queued to run.  If none exist, LEFF_NULL is returned.
  * This function also updates the global leff_prio to the
@@ -104,28 +181,13 @@ bool leff_running_p (leffnum_t dn)
  */
 static leffnum_t leff_get_highest_priority (void)
 {
-	U8 i;
-	U8 prio = 0;
-	U8 best = LEFF_NULL;
-
-	for (i=0; i < MAX_LEFFS; i++)
+	if (leff_queue_count == 0)
 	{
-		if (leff_running_p (i))
-		{
-			const leff_t *leff = &leff_table[i];
-			if (leff->flags & L_RUNNING && leff->prio > prio)
-			{
-				prio = leff->prio;
-				best = i;
-			}
-		}
+		leff_prio = 0;
+		return LEFF_NULL;
 	}
-
-	/* Save the priority of the best leff here */
-	leff_prio = prio;
-
-	/* Return the leffnum of the best leff to the caller */
-	return best;
+	leff_prio = leff_table[leff_queue[0]].prio;
+	return leff_queue[0];
 }
 
 
@@ -228,11 +290,18 @@ void leff_start (leffnum_t dn)
 	/* If this is an exclusive leff, and it lacks priority to run,
 	 * then return.  If marked RUNNING, it can be started later
 	 * so mark it pending. */
-	if (!(leff->flags & L_SHARED) && (leff->prio < leff_prio))
+	if (!(leff->flags & L_SHARED))
 	{
 		if (leff->flags & L_RUNNING)
+		{
 			bitarray_set (leffs_running, dn);
-		return;
+			leff_queue_add (dn);
+			if (!leff_running_p (dn))
+				return;
+		}
+		if (leff->prio < leff_prio)
+			return;
+		leff_prio = leff->prio;
 	}
 
 	/* Either it is shared, or the highest priority exclusive
@@ -287,6 +356,7 @@ void leff_stop (leffnum_t dn)
 	}
 	else
 	{
+		leff_queue_remove (dn);
 		lamp_leff1_erase (); /* TODO : these two functions go together */
 		lamp_leff1_free_all ();
 #ifdef CONFIG_GI
@@ -317,7 +387,8 @@ void leff_start_highest_priority (void)
 	{
 		const leff_t *leff = &leff_table[leff_active];
 		dbprintf ("leff_start_highest_priority returned %d\n", leff_active);
-		leff_create_handler (leff);
+		task_pid_t tp = leff_create_handler (leff);
+		(task_class_data (tp, leff_data_t))->id = leff_active;
 	}
 	else
 	{
@@ -356,6 +427,8 @@ __noreturn__ void leff_exit (void)
 		if (leff->gi != L_NOGI)
 			gi_leff_free (leff->gi);
 #endif
+		leff_queue_remove (leff_self_id);
+
 		/* Change the GID so that we are no longer
 		 * considered a leff. */
 		task_setgid (GID_LEFF_EXITING);
@@ -371,6 +444,8 @@ void leff_init (void)
 {
 	leff_prio = 0;
 	memset (leffs_running, 0, sizeof (leffs_running));
+	leff_queue_count = 0;
+	leff_queue_overflows = 0;
 }
 
 
@@ -381,6 +456,9 @@ void leff_stop_all (void)
 {
 	task_kill_gid (GID_LEFF);
 	task_kill_gid (GID_SHARED_LEFF);
+#ifdef CONFIG_LAMPSHOW
+	lampshow_leff_stop_all ();
+#endif
 #ifdef CONFIG_GI
 	gi_leff_free (PINIO_GI_STRINGS);
 #endif
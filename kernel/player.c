@@ -71,6 +71,7 @@ void player_start_game (void)
 
 	/* Clear lamps/flags */
 	memset (lamp_matrix, 0, NUM_LAMP_COLS);
+	lamp_mark_all_dirty ();
 	memset (bit_matrix, 0, BITS_TO_BYTES (MAX_FLAGS));
 }
 
@@ -96,6 +97,7 @@ void player_restore (void)
 {
 	/* Restore lamps/bits from the save area */
 	memcpy (lamp_matrix, save_area->local_lamps, NUM_LAMP_COLS);
+	lamp_mark_all_dirty ();
 	memcpy (bit_matrix, save_area->local_flags, BITS_TO_BYTES (MAX_FLAGS));
 	
 	/* Restore player locals from the save area */
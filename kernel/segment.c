@@ -379,6 +379,15 @@ void seg_erase (void)
 }
 
 
+/**
+ * Erase a single row of the current page.
+ */
+void seg_erase_row (U8 row)
+{
+	memset (&(*seg_writable_page)[row][0], 0, sizeof (seg_section_t));
+}
+
+
 /**
  * Fill the current page with the same character.
  */
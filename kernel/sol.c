@@ -151,6 +151,7 @@ sol_req_start_specific (U8 sol, U8 mask, U8 time)
 void sol_req_start (U8 sol)
 {
 	sol_pulsing = sol;
+	switch_latency_fire (sol);
 
 	/* Normally, just start sol_req_start_specific with default parameters.
 	But provide a hook that can override them.  Any machine that wants finer
@@ -209,6 +210,7 @@ void sol_request_async (U8 sol)
 		skipped, which must already be handled elsewhere as when a pulse
 		is too weak... */
 		queue_insert (&sol_req_queue.header, SOL_REQ_QUEUE_LEN, sol);
+		switch_latency_defer (sol);
 	}
 }
 
@@ -26,29 +26,37 @@
 #include <freewpc.h>
 #include <diag.h>
 #include <search.h>
+#include <system/swhandler.h>
 
 /*
  * A pending switch is one which has changed levels for 2
  * consecutive readings at interrupt time, but needs to
  * be debounced further.
  *
- * This struct tracks the switch number, its state, and the
- * debounce timer.
+ * This struct tracks the switch number and the time at which
+ * its debounce period ends.
  *
- * There are a finite number of these objects.  When a change
- * is detected, we will either allocate a new slot or
- * re-use an existing slot for the same switch that did not
- * complete its previous debounce cycle.
+ * There are a finite number of these objects.  Those in use are
+ * kept on a list sorted by expiry time, so that servicing the queue
+ * only needs to look at the entries at the front that have expired.
+ * The rest are kept on a free list.
  */
 typedef struct
 {
 	/* The switch number that is pending */
 	U8 id;
 
-	/* The amount of time left before the transition completes. */
-	S8 timer;
+	/* The index of the next entry on the same list, or
+	SWITCH_QUEUE_END */
+	U8 next;
+
+	/* The system time at which the transition completes. */
+	U16 expires;
 } pending_switch_t;
 
+/** Marks the end of a switch queue list */
+#define SWITCH_QUEUE_END 0xFF
+
 
 /** The raw input values of the switch.  These values are
  * updated every 2ms, and are only used as inputs into the
@@ -84,19 +92,20 @@ __fastram__ switch_bits_t sw_logical;
  * scan the entire array. */
 switch_bits_t sw_queued;
 
-/* An array of pending switches which have not fully debounced yet.
- * The array is kept compact, meaning that if there are N entries
- * used, they will always be in slots [0] to [N-1]. */
+/* An array of pending switches which have not fully debounced yet. */
 pending_switch_t switch_queue[MAX_QUEUED_SWITCHES];
 
-/* A pointer to the first free entry in the switch queue.
- * When this is equal to 'switch_queue', it means the entire
- * queue is empty. */
-__fastram__ pending_switch_t *switch_queue_top;
+/* The index of the pending switch that expires first, or
+ * SWITCH_QUEUE_END if the queue is empty. */
+__fastram__ U8 switch_queue_head;
 
-/** The last time that switch scanning occurred.  It is used
- * to determine by how much to decrement debounce timers. */
-U16 switch_last_service_time;
+/* The index of the first unused entry in the switch queue */
+U8 switch_queue_free;
+
+/* Nonzero if a switch could not be queued because the queue was
+ * full.  Such a switch is retried on the next pass; this flag ensures
+ * that each overflow is only audited once. */
+U8 switch_queue_overflowed;
 
 /** The switch number of the last switch to be scheduled.
  * Provided as a convenience for test mode. */
@@ -107,6 +116,34 @@ U8 sw_last_scheduled;
  * seconds to ignore switches. */
 U8 sw_short_timer;
 
+/** The maximum number of switch worker tasks */
+#define SWITCH_WORKERS 3
+
+/** The size of the switch event queue.  This must be a power of 2.
+ * Each queued event has claimed a worker to take it, so the queue never
+ * holds more than SWITCH_WORKERS entries. */
+#define SWITCH_EVENT_QUEUE_SIZE 4
+
+/** How long an idle worker waits for another event before it exits */
+#define SWITCH_WORKER_LINGER TIME_2S
+
+/** Per-task data for a switch worker */
+typedef struct
+{
+	/** Nonzero while the worker is processing an event, or has been
+	 * woken up to take one */
+	U8 busy;
+} switch_worker_data_t;
+
+/** Scheduled switch events that are waiting for a worker */
+U8 switch_event_queue[SWITCH_EVENT_QUEUE_SIZE];
+
+/** The number of events ever added to/removed from the event queue.
+ * Their difference is the number of events pending; the low bits give
+ * the queue slot. */
+U8 switch_event_head;
+U8 switch_event_tail;
+
 
 /** Return the switch table entry for a switch */
 const switch_info_t *switch_lookup (const switchnum_t sw)
@@ -344,7 +381,7 @@ void switch_rtt (void)
 
 typedef struct
 {
-	const switch_info_t *swinfo;
+	U8 lamp;
 	leff_data_t leffdata;
 } lamp_pulse_data_t;
 
@@ -361,40 +398,53 @@ void switch_lamp_pulse (void)
 	 * the right thing. */
 	cdata->leffdata.flags = L_SHARED;
 
-	/* If the lamp is already allocated by another lamp effect,
-	then don't bother trying to do the pulse. */
-	if (lamp_leff2_test_and_allocate (cdata->swinfo->lamp))
-	{
-		/* Change the state of the lamp */
-		if (lamp_test (cdata->swinfo->lamp))
-			leff_off (cdata->swinfo->lamp);
-		else
-			leff_on (cdata->swinfo->lamp);
-		task_sleep (TIME_200MS);
+	/* The lamp was allocated when this task was started.
+	Change the state of the lamp */
+	if (lamp_test (cdata->lamp))
+		leff_off (cdata->lamp);
+	else
+		leff_on (cdata->lamp);
+	task_sleep (TIME_200MS);
 
-		/* Change it back */
-		leff_toggle (cdata->swinfo->lamp);
-		task_sleep (TIME_200MS);
+	/* Change it back */
+	leff_toggle (cdata->lamp);
+	task_sleep (TIME_200MS);
 
-		/* Free the lamp */
-		lamp_leff2_free (cdata->swinfo->lamp);
-	}
+	/* Free the lamp */
+	lamp_leff2_free (cdata->lamp);
 	task_exit ();
 }
 
 
+/** Start a lamp pulse for a switch.  If the lamp is already allocated
+ * by another lamp effect (or a previous flicker), don't bother. */
+void switch_lamp_pulse_start (const U8 lamp)
+{
+	if (lamp_leff2_test_and_allocate (lamp))
+	{
+		task_pid_t tp = task_create_gid (GID_SWITCH_LAMP_PULSE,
+			switch_lamp_pulse);
+		task_init_class_data (tp, lamp_pulse_data_t)->lamp = lamp;
+	}
+}
+
+
 /*
- * The entry point for processing a switch transition.  It performs
- * some of the common switch handling logic before calling all
- * event handlers.  Then it also performs some common post-processing.
- * This function runs in a separate task context for each switch that
- * needs to be processed.
+ * Process a switch transition.  The common logic -- filtering by game
+ * and test mode, the lamp and sound, and the playfield and device
+ * handling -- is done by the switch's own handler, which genmachine
+ * specializes for each switch (see include/system/swhandler.h).  This
+ * function runs in the context of a switch worker, or in a separate
+ * task for the switch.
  */
-void switch_sched_task (void)
+static void switch_process (const U8 sw)
 {
-	const U8 sw = (U8)task_get_arg ();
 	const switch_info_t * const swinfo = switch_lookup (sw);
 
+	/* Coils pulsed from here on are charged to this switch in the
+	latency statistics. */
+	switch_latency_begin (sw);
+
 	/* Ignore any switch that doesn't have a processing function.
 	   This shouldn't ever happen if things are working correctly, but it
 		was observed on PIC games when the PIC code is broken and reporting
@@ -409,32 +459,6 @@ void switch_sched_task (void)
 
 	log_event (SEV_INFO, MOD_SWITCH, EV_SW_SCHEDULE, sw);
 
-	/* Don't service switches marked SW_IN_GAME if we're
-	 * not presently in a game */
-	if ((swinfo->flags & SW_IN_GAME) && !in_game)
-		goto cleanup;
-
-	/* Don't service switches not marked SW_IN_TEST, unless we're
-	 * actually in test mode */
-	if (!(swinfo->flags & SW_IN_TEST) && in_test)
-		goto cleanup;
-
-	/* If the switch has an associated lamp, then flicker the lamp when
-	 * the switch triggers. */
-	if ((swinfo->lamp != 0) && in_live_game)
-	{
-		task_pid_t tp = task_create_gid (GID_SWITCH_LAMP_PULSE,
-			switch_lamp_pulse);
-
-		lamp_pulse_data_t *cdata = task_init_class_data (tp, lamp_pulse_data_t);
-		cdata->swinfo = swinfo;
-	}
-
-	/* If we're in a live game and the switch declares a standard
-	 * sound, then make it happen. */
-	if ((swinfo->sound != 0) && in_live_game)
-		sound_send (swinfo->sound);
-
 #ifdef DEBUGGER
 	if (swinfo->fn != null_function && sw < 72)
 	{
@@ -448,52 +472,118 @@ void switch_sched_task (void)
 	}
 #endif
 
-	/* If the switch declares a processing function, call it. */
-	if (swinfo->fn)
+	/* Switches declared 'unused' have no handler of their own, but
+	still get the common processing, with nothing to call. */
+	if (swinfo->fn == null_function)
+		switch_handler_common (sw, null_function, swinfo->flags,
+			swinfo->lamp, 0, swinfo->devno);
+	else
 		callset_pointer_invoke (swinfo->fn);
 
-	/* Declare this as a hardware event that affects the random number
-	generator. */
-	random_hw_event ();
+cleanup:
+	switch_latency_end ();
+}
+
 
-	/* If a switch is marked SW_PLAYFIELD and we're in a game,
-	 * then call the global playfield switch handler and check for
-	 * valid playfield.  Also, reset the ball search timer so that
-	 * it doesn't expire.
-	 */
-	if ((swinfo->flags & SW_PLAYFIELD) && in_game)
+/*
+ * The entry point for a task that processes a single switch
+ * transition, given as the task argument.
+ */
+void switch_sched_task (void)
+{
+	switch_process ((U8)task_get_arg ());
+	task_exit ();
+}
+
+
+/*
+ * The entry point for a switch worker.  A worker takes scheduled switch
+ * events off the event queue and processes them one at a time.  When
+ * the queue is empty, it waits until switch_schedule() wakes it for
+ * another event, and exits if nothing arrives for a while.
+ *
+ * While idle, a worker survives the end of a ball or game, but while
+ * processing an event it has the same duration that a switch task
+ * would have.
+ */
+void switch_worker_task (void)
+{
+	switch_worker_data_t * const wdata =
+		task_current_class_data (switch_worker_data_t);
+	U16 idle_since = get_sys_time ();
+	U8 sw;
+
+	for (;;)
 	{
-		callset_invoke (any_pf_switch);
-
-		/* If valid playfield was not asserted yet, then see if this
-		 * switch validates it.  Most playfield switches do this right
-		 * away, but for some switches, like special solenoids (jets
-		 * or slings), which could repeatedly trigger if misaligned,
-		 * count the activations and validate only when some number
-		 * of different switches have triggered.  Device counting
-		 * switches are ignored here, but an 'enter' event will
-		 * set it. */
-		if (!valid_playfield)
+		if (switch_event_tail != switch_event_head)
 		{
-			if (swinfo->flags & SW_NOVALID)
-			{
-				if (!SW_HAS_DEVICE (swinfo))
-					try_validate_playfield (sw);
-			}
-			else
-				set_valid_playfield ();
+			sw = switch_event_queue[switch_event_tail++ & (SWITCH_EVENT_QUEUE_SIZE-1)];
+			wdata->busy = TRUE;
+			task_add_duration (TASK_DURATION_BALL);
+			switch_process (sw);
+
+			/* If the event handler moved this task into a different
+			group, then it is no longer a worker. */
+			if (task_getgid () != GID_SW_WORKER)
+				task_exit ();
+
+			task_remove_duration (TASK_DURATION_BALL);
+			idle_since = get_sys_time ();
+		}
+		else if (time_reached_p (idle_since + SWITCH_WORKER_LINGER))
+		{
+			task_exit ();
+		}
+		else
+		{
+			/* Another worker may have taken the event that this one
+			was woken for.  Go back to waiting. */
+			wdata->busy = FALSE;
+			task_wait (SWITCH_WORKER_LINGER);
 		}
-		ball_search_timer_reset ();
 	}
+}
 
-cleanup:
-	/* If the switch is part of a device, then let the device
-	 * subsystem process the event.  Note this will always occur
-	 * regardless of any of the above conditions checked. */
-	if (SW_HAS_DEVICE (swinfo))
-		device_sw_handler (SW_GET_DEVICE (swinfo));
 
-	task_exit ();
+/*
+ * Schedule a switch event for processing.  If a worker is idle, the event
+ * is queued and that worker is woken up to take it.  Otherwise, a new
+ * worker is started if the pool is not full.  When all workers are busy --
+ * for example, because some handler is sleeping -- a separate task is
+ * started for the event as a last resort, so that it is not held up.
+ */
+static void switch_schedule (const U8 sw)
+{
+	task_pid_t tp;
+	task_pid_t idle = NULL;
+	U8 workers = 0;
+
+	for (tp = task_find_gid (GID_SW_WORKER); tp;
+		tp = task_find_gid_next (tp, GID_SW_WORKER))
+	{
+		workers++;
+		if (!task_class_data (tp, switch_worker_data_t)->busy)
+			idle = tp;
+	}
+
+	if (idle == NULL)
+	{
+		if (workers >= SWITCH_WORKERS)
+		{
+			tp = task_create_gid (GID_SW_HANDLER, switch_sched_task);
+			task_set_arg (tp, sw);
+			return;
+		}
+		idle = task_create_gid (GID_SW_WORKER, switch_worker_task);
+		task_set_duration (idle, TASK_DURATION_INF);
+		task_init_class_data (idle, switch_worker_data_t);
+	}
+
+	/* Mark the worker busy now, so that another event does not pick
+	the same worker before it has had a chance to run. */
+	task_class_data (idle, switch_worker_data_t)->busy = TRUE;
+	task_wakeup (idle);
+	switch_event_queue[switch_event_head++ & (SWITCH_EVENT_QUEUE_SIZE-1)] = sw;
 }
 
 
@@ -538,45 +628,66 @@ void switch_transitioned (const U8 sw)
 			return;
 #endif
 
-		/* Start a task to process the switch event.
-		This task may sleep if necessary, but it should be as fast as possible
+		/* Hand the event to a worker task to process.
+		The handlers may sleep if necessary, but they should be as fast as possible
 		and push long-lived operations into separate background tasks.
-		It is possible for more than one instance of a task to exist for the same
-		switch, if valid debounced transitions occur quickly. */
-		task_pid_t tp = task_create_gid (GID_SW_HANDLER, switch_sched_task);
-		task_set_arg (tp, sw);
+		It is possible for the same switch to be processed more than once at
+		the same time, if valid debounced transitions occur quickly. */
+		switch_schedule (sw);
 	}
 }
 
 
-/** Add a new entry to the switch queue. */
+/** Add a new entry to the switch queue.  It is inserted after all
+ * entries that expire at the same time or earlier.  If the queue is full,
+ * the switch is not queued, but it remains stable and will be tried
+ * again on the next pass. */
 void switch_queue_add (const switchnum_t sw)
 {
-	if (switch_queue_top < switch_queue + MAX_QUEUED_SWITCHES)
+	U8 n = switch_queue_free;
+	pending_switch_t *entry;
+	U8 *np;
+
+	if (n == SWITCH_QUEUE_END)
 	{
-		dbprintf ("adding %d to queue\n", sw);
-		switch_queue_top->id = sw;
-		switch_queue_top->timer = switch_lookup(sw)->debounce;
-		bit_on (sw_queued, sw);
-		switch_queue_top++;
+		if (!switch_queue_overflowed)
+		{
+			switch_queue_overflowed = TRUE;
+			audit_increment (&system_audits.switch_queue_overflows);
+		}
+		return;
 	}
-}
 
-
-/** Remove an entry from the switch queue */
-void switch_queue_remove (pending_switch_t *entry)
-{
-	/* Copy the last entry in the queue into the slot being deleted. */
-	entry->id = (switch_queue_top-1)->id;
-	entry->timer = (switch_queue_top-1)->timer;
-	switch_queue_top--;
-	bit_off (sw_queued, entry->id);
+	dbprintf ("adding %d to queue\n", sw);
+	entry = &switch_queue[n];
+	switch_queue_free = entry->next;
+	switch_queue_overflowed = FALSE;
+
+	entry->id = sw;
+	entry->expires = get_sys_time () + switch_lookup(sw)->debounce;
+	bit_on (sw_queued, sw);
+
+	np = &switch_queue_head;
+	while (*np != SWITCH_QUEUE_END &&
+		!((entry->expires - switch_queue[*np].expires) & 0x8000UL))
+		np = &switch_queue[*np].next;
+	entry->next = *np;
+	*np = n;
 }
 
+
 /** Initialize the switch queue */
 void switch_queue_init (void)
 {
-	switch_queue_top = switch_queue;
+	U8 n;
+
+	switch_queue_head = SWITCH_QUEUE_END;
+	for (n = 0; n < MAX_QUEUED_SWITCHES-1; n++)
+		switch_queue[n].next = n+1;
+	switch_queue[MAX_QUEUED_SWITCHES-1].next = SWITCH_QUEUE_END;
+	switch_queue_free = 0;
+	switch_queue_overflowed = FALSE;
+	switch_event_head = switch_event_tail = 0;
 	memset (sw_stable, 0, sizeof (sw_stable));
 	memset (sw_unstable, 0, sizeof (sw_unstable));
 	memset (sw_queued, 0, sizeof (sw_queued));
@@ -585,51 +696,47 @@ void switch_queue_init (void)
 
 /** Service the switch queue.  This function is called
  * periodically to see if any pending switch transitions have
- * completed their debounce time.  If any switch becomes
- * unstable before the period expires, it will be removed
- * from the queue prior to this function being called.  So
- * all that is needed here is to decrement the timers, and if
- * one reaches zero, consider that switch transitioned.
+ * completed their debounce time.  Since the queue is sorted by
+ * expiry time, only the entries at the front need to be checked.
+ * Each one that has expired is removed, and the switch is
+ * considered transitioned if it remained stable throughout.
  */
 void switch_service_queue (void)
 {
 	pending_switch_t *entry;
-	U8 elapsed_time;
-
-	/* See how long since the last time we serviced the queue.
-	This is in 16ms ticks. */
-	elapsed_time = get_elapsed_time (switch_last_service_time);
+	U8 n;
 
-	entry = switch_queue;
-	while (unlikely (entry < switch_queue_top))
+	while ((n = switch_queue_head) != SWITCH_QUEUE_END)
 	{
-		entry->timer -= elapsed_time;
-		if (entry->timer <= 0)
+		entry = &switch_queue[n];
+
+		/* Stop at the first entry whose debounce interval has not
+		completed yet */
+		if ((get_sys_time () - entry->expires) & 0x8000UL)
+			break;
+
+		/* The entry can be removed from the queue */
+		switch_queue_head = entry->next;
+		entry->next = switch_queue_free;
+		switch_queue_free = n;
+		bit_off (sw_queued, entry->id);
+
+		/* See if the switch held its state during the debounce period */
+		if (bit_test (sw_unstable, entry->id))
+		{
+			/* Debouncing failed, so don't process the switch.
+			 * Restart IRQ-level scanning. */
+			disable_irq ();
+			bit_off (sw_stable, entry->id);
+			bit_off (sw_unstable, entry->id);
+			enable_irq ();
+		}
+		else
 		{
-			/* Debounce interval is complete.  The entry can be removed
-			from the queue */
-			switch_queue_remove (entry);
-
-			/* See if the switch held its state during the debounce period */
-			if (bit_test (sw_unstable, entry->id))
-			{
-				/* Debouncing failed, so don't process the switch.
-				 * Restart IRQ-level scanning. */
-				disable_irq ();
-				bit_off (sw_stable, entry->id);
-				bit_off (sw_unstable, entry->id);
-				enable_irq ();
-			}
-			else
-			{
-				/* Debouncing succeeded, so process the switch */
-				switch_transitioned (entry->id);
-			}
+			/* Debouncing succeeded, so process the switch */
+			switch_transitioned (entry->id);
 		}
-		entry++;
 	}
-
-	switch_last_service_time = get_sys_time ();
 }
 
 
@@ -646,15 +753,11 @@ static inline void switch_matrix_dump (const char *name, U8 *matrix)
 
 void switch_queue_dump (void)
 {
-	pending_switch_t *entry = switch_queue;
+	U8 n;
 
-	dbprintf ("Switch queue base: %p\n", switch_queue);
-	dbprintf ("Switch queue top: %p\n", switch_queue_top);
-	while (entry != switch_queue_top)
-	{
-		dbprintf ("Pending: SW%d  %d\n", entry->id, entry->timer);
-		entry++;
-	}
+	dbprintf ("Switch queue at %ld\n", get_sys_time ());
+	for (n = switch_queue_head; n != SWITCH_QUEUE_END; n = switch_queue[n].next)
+		dbprintf ("Pending: SW%d  %ld\n", switch_queue[n].id, switch_queue[n].expires);
 	switch_matrix_dump ("Raw     ", sw_raw);
 	switch_matrix_dump ("Logical ", sw_logical);
 	switch_matrix_dump ("Edge    ", sw_edge);
@@ -769,15 +872,6 @@ CALLSET_ENTRY (switch, diagnostic_check)
 }
 
 
-/** Do final initializing once system init is complete. */
-CALLSET_ENTRY (switch, init_complete)
-{
-	/* Initialize the service timer.  This needs to happen
-	 * just before interrupts are enabled */
-	switch_last_service_time = get_sys_time ();
-}
-
-
 /** Once per second, see if we had disabled switch scanning
  * due to a short, and it should be reenabled now.  This
  * is not accurately timed: it may range from 2.1 to 3s of
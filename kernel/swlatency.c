@@ -0,0 +1,392 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * \file
+ * \brief Measure the time from a switch closure to the coil it fires.
+ *
+ * The switch edge is timestamped when switch_rtt first sees it, in
+ * sw_edge.  The coil end is timestamped when the pulse is started: from
+ * sol_req_start for ordinary requests, and from interrupt level for
+ * special solenoids and Fliptronic flippers, which fire without help from
+ * a task.  The difference is accumulated per switch/coil pair.
+ *
+ * Requests made in task context are charged to the switch whose handler
+ * is running at the time.  If the handler sleeps, another switch may be
+ * processed meanwhile, and later pulses from the first handler are then
+ * charged to the other one, so treat those numbers as approximate.
+ */
+
+#include <freewpc.h>
+
+/** The number of switch edges whose stamps are remembered at once.
+When full, the oldest stamp is replaced. */
+#define SWITCH_LATENCY_EDGES 8
+
+/** A stamp older than this (in milliseconds) is for an activation that was
+never processed, e.g. a short pulse that failed debouncing, and is
+replaced when the switch activates again */
+#define SWITCH_LATENCY_STALE 256
+
+/** The number of queued coil requests whose stamps are remembered */
+#define SWITCH_LATENCY_DEFERRED 4
+
+typedef struct
+{
+	U8 sw;
+	U8 sol;
+	U16 stamp;
+} switch_latency_stamp_t;
+
+/** A millisecond clock, advanced by switch_latency_rtt */
+__fastram__ U16 switch_latency_clock;
+
+/** The sw_edge bits as of the previous scan, so that only new
+edges are stamped */
+switch_bits_t switch_latency_seen;
+
+/** Switch edges seen at interrupt level that have not yet been
+processed */
+switch_latency_stamp_t switch_latency_edges[SWITCH_LATENCY_EDGES];
+U8 switch_latency_edge_next;
+
+/** Coil requests that went onto the solenoid queue, with the switch
+and stamp of the handler that made them */
+switch_latency_stamp_t switch_latency_deferred[SWITCH_LATENCY_DEFERRED];
+U8 switch_latency_deferred_next;
+
+/** The switch whose handler is running now, and its stamp */
+U8 switch_latency_current;
+U16 switch_latency_current_stamp;
+
+/** The most recent Fliptronic outputs, to find new power pulses */
+U8 switch_latency_flip_outputs;
+
+/** The collected statistics */
+switch_latency_pair_t switch_latency_table[SWITCH_LATENCY_PAIRS];
+
+/** The number of samples that were lost because the table was full */
+U16 switch_latency_dropped;
+
+
+/** Add one sample to the statistics for a pair.  This is called from
+both task and interrupt level; task callers must disable interrupts. */
+static void switch_latency_record (U8 sw, U8 sol, U16 latency)
+{
+	switch_latency_pair_t *pair;
+	switch_latency_pair_t *empty = NULL;
+	U8 n;
+	U8 bucket;
+	U16 val;
+
+	for (pair = switch_latency_table, n = 0; n < SWITCH_LATENCY_PAIRS; pair++, n++)
+	{
+		if (pair->sw == sw && pair->sol == sol)
+			goto found;
+		if (!empty && pair->sw == SWITCH_LATENCY_NONE)
+			empty = pair;
+	}
+
+	if (!empty)
+	{
+		switch_latency_dropped++;
+		return;
+	}
+	pair = empty;
+	pair->sw = sw;
+	pair->sol = sol;
+	pair->min = 0xFFFF;
+
+found:
+	if (pair->count == 0xFFFF)
+		return;
+	pair->count++;
+	if (latency < pair->min)
+		pair->min = latency;
+	if (latency > pair->max)
+		pair->max = latency;
+
+	if (pair->total & 0x8000)
+	{
+		pair->total >>= 1;
+		pair->total_count >>= 1;
+	}
+	pair->total += latency;
+	pair->total_count++;
+
+	bucket = 0;
+	val = latency >> 1;
+	while (val && bucket < SWITCH_LATENCY_BUCKETS-1)
+	{
+		val >>= 1;
+		bucket++;
+	}
+	pair->hist[bucket]++;
+}
+
+
+/** Find the stamp for a switch edge that has not been processed yet */
+static switch_latency_stamp_t *switch_latency_edge_find (U8 sw)
+{
+	switch_latency_stamp_t *edge;
+	U8 n;
+
+	for (edge = switch_latency_edges, n = 0; n < SWITCH_LATENCY_EDGES; edge++, n++)
+		if (edge->sw == sw)
+			return edge;
+	return NULL;
+}
+
+
+/** Stamp the new edges in one switch column.  If a switch bounces
+before it is debounced, its first stamp is kept. */
+static void switch_latency_stamp (U8 col, U8 rows)
+{
+	U8 sw = col * 8;
+	switch_latency_stamp_t *edge;
+
+	do {
+		if (rows & 1)
+		{
+			edge = switch_latency_edge_find (sw);
+			if (!edge)
+			{
+				edge = &switch_latency_edges[switch_latency_edge_next];
+				edge->sw = sw;
+				edge->stamp = switch_latency_clock;
+				switch_latency_edge_next =
+					(switch_latency_edge_next + 1) % SWITCH_LATENCY_EDGES;
+			}
+			else if (switch_latency_clock - edge->stamp >= SWITCH_LATENCY_STALE)
+				edge->stamp = switch_latency_clock;
+		}
+		sw++;
+		rows >>= 1;
+	} while (rows);
+}
+
+
+/** Realtime function that advances the clock and stamps switch
+edges.  It must run right after switch_rtt, at the same rate.
+Only edges toward the active level are stamped; releases do not
+fire coils. */
+void switch_latency_rtt (void)
+{
+	U8 col;
+	U8 fresh;
+
+	switch_latency_clock += 2;
+	for (col = 0; col < SWITCH_BITS_SIZE; col++)
+	{
+		fresh = sw_edge[col] & ~switch_latency_seen[col];
+		switch_latency_seen[col] = sw_edge[col];
+		fresh &= sw_raw[col] ^ mach_opto_mask[col];
+		if (unlikely (fresh))
+			switch_latency_stamp (col, fresh);
+	}
+}
+
+
+/** Called from interrupt level when a coil is fired directly by a
+switch.  The driver polls the raw switch itself, so it may see the
+closure before switch_rtt does; that is counted as zero latency.  The
+stamp is left for the switch handler. */
+void switch_latency_rt_fire (U8 sw, U8 sol)
+{
+	switch_latency_stamp_t *edge = switch_latency_edge_find (sw);
+	switch_latency_record (sw, sol, edge ? switch_latency_clock - edge->stamp : 0);
+}
+
+
+/** Called from fliptronic_rtt with the flipper outputs that it is
+about to write.  Outputs for flippers that are being held on by
+software must already be masked off.  Every new power pulse is a
+flipper firing. */
+void switch_latency_flipper_rtt (U8 outputs)
+{
+#if (MACHINE_FLIPTRONIC == 1)
+	U8 fresh = outputs & ~switch_latency_flip_outputs;
+	switch_latency_flip_outputs = outputs;
+
+	if (unlikely (fresh & WPC_LR_FLIP_POWER))
+		switch_latency_rt_fire (SW_L_R_FLIPPER_BUTTON, SOL_LR_FLIP_POWER);
+	if (unlikely (fresh & WPC_LL_FLIP_POWER))
+		switch_latency_rt_fire (SW_L_L_FLIPPER_BUTTON, SOL_LL_FLIP_POWER);
+#ifdef MACHINE_HAS_UPPER_RIGHT_FLIPPER
+	if (unlikely (fresh & WPC_UR_FLIP_POWER))
+		switch_latency_rt_fire (SW_U_R_FLIPPER_BUTTON, SOL_UR_FLIP_POWER);
+#endif
+#ifdef MACHINE_HAS_UPPER_LEFT_FLIPPER
+	if (unlikely (fresh & WPC_UL_FLIP_POWER))
+		switch_latency_rt_fire (SW_U_L_FLIPPER_BUTTON, SOL_UL_FLIP_POWER);
+#endif
+#endif
+}
+
+
+/** Called before a switch handler runs.  Takes the switch's edge stamp,
+so that coils started by the handler can be charged to it. */
+void switch_latency_begin (U8 sw)
+{
+	switch_latency_stamp_t *edge;
+
+	disable_irq ();
+	edge = switch_latency_edge_find (sw);
+	if (edge)
+	{
+		switch_latency_current = sw;
+		switch_latency_current_stamp = edge->stamp;
+		edge->sw = SWITCH_LATENCY_NONE;
+	}
+	else
+		switch_latency_current = SWITCH_LATENCY_NONE;
+	enable_irq ();
+}
+
+
+/** Called after a switch handler returns */
+void switch_latency_end (void)
+{
+	switch_latency_current = SWITCH_LATENCY_NONE;
+}
+
+
+/** Called when a coil request must wait on the solenoid queue.  The
+current switch and its stamp are saved until the pulse starts. */
+void switch_latency_defer (U8 sol)
+{
+	switch_latency_stamp_t *def;
+
+	if (switch_latency_current == SWITCH_LATENCY_NONE)
+		return;
+	def = &switch_latency_deferred[switch_latency_deferred_next];
+	def->sw = switch_latency_current;
+	def->sol = sol;
+	def->stamp = switch_latency_current_stamp;
+	switch_latency_deferred_next =
+		(switch_latency_deferred_next + 1) % SWITCH_LATENCY_DEFERRED;
+}
+
+
+/** Called from sol_req_start when a coil pulse begins */
+void switch_latency_fire (U8 sol)
+{
+	switch_latency_stamp_t *def;
+	U8 n;
+
+	for (def = switch_latency_deferred, n = 0; n < SWITCH_LATENCY_DEFERRED; def++, n++)
+	{
+		if (def->sw != SWITCH_LATENCY_NONE && def->sol == sol)
+		{
+			disable_irq ();
+			switch_latency_record (def->sw, sol, switch_latency_clock - def->stamp);
+			enable_irq ();
+			def->sw = SWITCH_LATENCY_NONE;
+			return;
+		}
+	}
+
+	if (switch_latency_current != SWITCH_LATENCY_NONE)
+	{
+		disable_irq ();
+		switch_latency_record (switch_latency_current, sol,
+			switch_latency_clock - switch_latency_current_stamp);
+		enable_irq ();
+	}
+}
+
+
+/** Return the average latency for a pair */
+U16 switch_latency_average (const switch_latency_pair_t *pair)
+{
+	if (pair->total_count == 0)
+		return 0;
+	return pair->total / pair->total_count;
+}
+
+
+/** Return the 99th percentile latency for a pair.  This is the upper
+bound of the histogram bucket that contains it, but never more than the
+largest latency actually seen. */
+U16 switch_latency_p99 (const switch_latency_pair_t *pair)
+{
+	U16 limit = pair->count - pair->count / 100;
+	U16 sum = 0;
+	U16 bound;
+	U8 bucket;
+
+	for (bucket = 0; bucket < SWITCH_LATENCY_BUCKETS-1; bucket++)
+	{
+		sum += pair->hist[bucket];
+		if (sum >= limit)
+			break;
+	}
+
+	bound = (2 << bucket) - 1;
+	if (bucket == SWITCH_LATENCY_BUCKETS-1 || bound > pair->max)
+		bound = pair->max;
+	return bound;
+}
+
+
+/** Clear all of the statistics */
+void switch_latency_reset (void)
+{
+	U8 n;
+
+	disable_irq ();
+	memset (switch_latency_table, 0, sizeof (switch_latency_table));
+	for (n = 0; n < SWITCH_LATENCY_PAIRS; n++)
+		switch_latency_table[n].sw = SWITCH_LATENCY_NONE;
+	for (n = 0; n < SWITCH_LATENCY_EDGES; n++)
+		switch_latency_edges[n].sw = SWITCH_LATENCY_NONE;
+	for (n = 0; n < SWITCH_LATENCY_DEFERRED; n++)
+		switch_latency_deferred[n].sw = SWITCH_LATENCY_NONE;
+	switch_latency_current = SWITCH_LATENCY_NONE;
+	switch_latency_dropped = 0;
+	enable_irq ();
+}
+
+
+void switch_latency_dump (void)
+{
+#ifdef DEBUGGER
+	switch_latency_pair_t *pair;
+	U8 n;
+
+	dbprintf ("SW  SOL  COUNT  MIN  AVG  MAX  P99\n");
+	for (pair = switch_latency_table, n = 0; n < SWITCH_LATENCY_PAIRS; pair++, n++)
+	{
+		if (pair->sw == SWITCH_LATENCY_NONE)
+			continue;
+		dbprintf ("%2d  %3d  %5ld  %3ld  %3ld  %3ld  %3ld\n",
+			pair->sw, pair->sol, pair->count, pair->min,
+			switch_latency_average (pair), pair->max,
+			switch_latency_p99 (pair));
+	}
+	dbprintf ("Dropped = %ld\n", switch_latency_dropped);
+#endif
+}
+
+
+CALLSET_ENTRY (switch_latency, init)
+{
+	switch_latency_reset ();
+}
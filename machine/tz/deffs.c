@@ -67,11 +67,10 @@ void extra_ball_deff (void)
 {
 	sound_send (SND_HERES_YOUR_EB);
 	U16 fno;
+	frame_stream_begin ();
 	for (fno = IMG_EBALL_START; fno <= IMG_EBALL_END; fno += 2)
 	{
-		dmd_alloc_pair ();
-		frame_draw (fno);
-		dmd_show2 ();
+		frame_stream_draw (fno);
 		task_sleep (TIME_66MS);
 	}
 	task_sleep_sec (2);
@@ -82,13 +81,12 @@ void driver_deff (void)
 {
 	U16 fno;
 	U8 i;
+	frame_stream_begin ();
 	for (i = 0; i < 3; i++)
 	{
 		for (fno = IMG_DRIVER_START; fno <= IMG_DRIVER_END; fno += 2)
 		{
-			dmd_alloc_pair ();
-			frame_draw (fno);
-			dmd_show2 ();
+			frame_stream_draw (fno);
 			task_sleep (TIME_66MS);
 		}
 	}
@@ -54,35 +54,15 @@ struct timed_mode_ops tsm_mode = {
 	.pause = system_timer_pause,
 };
 
-void jets_active_task (void)
-{
-	while (tsm_mode_timer > 0)
-	{
-		lamp_tristate_off (LM_RIGHT_JET);
-		lamp_tristate_on (LM_LEFT_JET);
-		task_sleep (TIME_100MS);	
-		lamp_tristate_off (LM_LEFT_JET);
-		lamp_tristate_on (LM_LOWER_JET);
-		task_sleep (TIME_100MS);	
-		lamp_tristate_off (LM_LOWER_JET);
-		lamp_tristate_on (LM_RIGHT_JET);
-		task_sleep (TIME_100MS);	
-	}
-	lamp_tristate_on (LM_LEFT_JET);
-	lamp_tristate_on (LM_LOWER_JET);
-	lamp_tristate_on (LM_RIGHT_JET);
-	task_exit ();
-}
-
 void tsm_mode_init (void)
 {
-	task_create_gid (GID_JETS_ACTIVE_TASK, jets_active_task);
+	lampshow_start (LAMPSHOW_JETS_CHASE);
 	score_zero (tsm_mode_total);
 }
 
 void tsm_mode_exit (void)
 {
-	task_kill_gid (GID_JETS_ACTIVE_TASK);
+	lampshow_stop (LAMPSHOW_JETS_CHASE);
 }
 
 CALLSET_ENTRY(jet, start_ball)
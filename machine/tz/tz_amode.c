@@ -71,14 +71,12 @@ void show_driver_animation (void)
 	/* Show driver animation */	
 	U16 fno;
 	U8 i;
+	frame_stream_begin ();
 	for (i = 0; i < 5; i++)
 	{
 		for (fno = IMG_DRIVER_START; fno <= IMG_DRIVER_END; fno += 2)
 		{
-			/* We are drawing a full frame, so a clean isn't needed */
-			dmd_alloc_pair ();
-			frame_draw (fno);
-			dmd_show2 ();
+			frame_stream_draw (fno);
 			task_sleep (TIME_66MS);
 		}
 	}
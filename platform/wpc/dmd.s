@@ -29,12 +29,12 @@ DMD_PAGE_WIDTH=512
 
 	;--------------------------------------------------------
 	;
-	; void dmd_clean_page (void *dst);
+	; void dmd_clean_page_asm (void *dst);
 	;
 	; X = pointer to display page
 	;--------------------------------------------------------
-	.globl _dmd_clean_page
-_dmd_clean_page:
+	.globl _dmd_clean_page_asm
+_dmd_clean_page_asm:
 	pshs	y,u
 
 	leau	DMD_PAGE_WIDTH,x
@@ -216,7 +216,7 @@ _frame_decode_sparse_asm:
 	; First, clear the output page.
 	tfr	x,u
 	ldx	#DMD_LOW_BASE
-	jsr	_dmd_clean_page
+	jsr	_dmd_clean_page_asm
 	tfr	u,x
 
 	ldu	#DMD_LOW_BASE
@@ -250,3 +250,107 @@ sparse_done:
 	puls	u,pc
 
 
+	;--------------------------------------------------------
+	;
+	; void frame_decode_lz_asm (void *src);
+	;
+	; X = pointer to source image data
+	;
+	;--------------------------------------------------------
+	; An LZ image is a series of tokens.  A positive token
+	; is a count of literal bytes which follow.  A negative
+	; token says to copy (token & 0x7F) + 3 bytes from earlier
+	; in the output; the byte after the token says how far back.
+	; The copy may overlap its own output, which is how runs
+	; are encoded, so it is done a byte at a time.  A zero
+	; token ends the image.
+	.globl _frame_decode_lz_asm
+_frame_decode_lz_asm:
+	pshs	u,y
+
+	; Read the source through U, and write the output
+	; through X.
+	tfr	x,u
+	ldx	#DMD_LOW_BASE
+
+lz_loop:
+	ldb	,u+
+	beq	lz_done
+	bmi	lz_copy
+
+lz_literal_loop:
+	lda	,u+
+	sta	,x+
+	decb
+	bne	lz_literal_loop
+	bra	lz_loop
+
+lz_copy:
+	andb	#0x7F
+	addb	#3
+	stb	*m0
+
+	; Point Y at the bytes to be copied.  The offset is
+	; between 1 and 255, so after the negb the carry is
+	; always set, and sbca makes D the negative offset.
+	ldb	,u+
+	clra
+	negb
+	sbca	#0
+	leay	d,x
+
+lz_copy_loop:
+	lda	,y+
+	sta	,x+
+	dec	*m0
+	bne	lz_copy_loop
+	bra	lz_loop
+
+lz_done:
+	puls	u,y,pc
+
+
+	;--------------------------------------------------------
+	;
+	; void frame_decode_xor_asm (void *src);
+	;
+	; X = pointer to source image data
+	;
+	;--------------------------------------------------------
+	; An XOR image is the second plane of a frame, stored as
+	; its differences from the first plane.  The caller has
+	; already copied the first plane to the output page.
+	; The image is a set of <len, skip, data[]> blocks:
+	; skip is an unsigned byte count to move the output
+	; pointer, then len 16-bit words are XORed into the
+	; output.  A block with both len and skip zero ends
+	; the image.
+	.globl _frame_decode_xor_asm
+_frame_decode_xor_asm:
+	pshs	u
+
+	tfr	x,u
+	ldx	#DMD_LOW_BASE
+
+xor_loop:
+	ldd	,u++
+	abx
+	tsta
+	beq	xor_skip_only
+	sta	*m0
+
+xor_block_loop:
+	ldd	,x
+	eora	,u+
+	eorb	,u+
+	std	,x++
+	dec	*m0
+	bne	xor_block_loop
+	bra	xor_loop
+
+xor_skip_only:
+	tstb
+	bne	xor_loop
+	puls	u,pc
+
+
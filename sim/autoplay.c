@@ -0,0 +1,269 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <freewpc.h>
+#include <simulation.h>
+
+/* This module plays the game automatically, by moving balls through the
+	node graph the way a player would.  Unlike the switch stress test, which
+	runs inside the game program and fakes switch events, all of the
+	switch activity here comes from real ball movements, so devices,
+	diverters and multiball behave as they would on the real machine.
+
+	A ball on the open playfield is assumed to reach the flippers after
+	a random travel time.  There, the player either makes a flip, sending
+	the ball to one of the configured shots, or misses and lets it drain.
+	The shots are weighted, so that some are made more often than others;
+	once the ball reaches a shot, the node graph decides where it goes
+	afterwards.  Balls left in the shooter lane are plunged after a short
+	delay.
+
+	The shots are normally given in the machine's conf file with the
+	'autoplay shot' command.  If none are given, every playfield switch
+	is used with equal weight. */
+
+#define MAX_SHOTS 64
+
+extern const switch_info_t switch_table[];
+
+/* The time between checks of the playfield, in milliseconds */
+#define AUTOPLAY_TICK 100
+
+/* The time that a flipper button is held */
+#define FLIP_TIME 100
+
+struct autoplay_shot
+{
+	struct ball_node *node;
+	unsigned int weight;
+};
+
+static struct autoplay_shot shot_table[MAX_SHOTS];
+static unsigned int shot_count;
+static unsigned int shot_weight_total;
+
+/** Nonzero when automatic play is on */
+static int autoplay_enabled;
+
+/** Nonzero once the periodic handler has been registered */
+static int autoplay_registered;
+
+/** Time until the next ball reaches the flippers */
+static int autoplay_flip_timer;
+
+/** Time that a ball has been waiting in the shooter lane */
+static int autoplay_shooter_timer;
+
+/** The chance of a good flip, as a percentage.  Otherwise the ball
+drains. */
+int autoplay_skill = 85;
+
+/** The average time taken by a ball to return to the flippers */
+int autoplay_travel = 2000;
+
+/** The time a ball is left in the shooter lane before plunging */
+int autoplay_plunge = 1000;
+
+/* Counters which can be read with the 'print' command */
+int autoplay_flips;
+int autoplay_drains;
+int autoplay_plunges;
+
+
+/** Return a random number from 0 to N-1 */
+static unsigned int autoplay_random (unsigned int n)
+{
+	return rand () % n;
+}
+
+
+/** Return the node for a switch.  Switches in a ball device use the
+device node, so that the device sees the ball enter. */
+static struct ball_node *autoplay_switch_node (unsigned int sw)
+{
+	const switch_info_t *swinfo = &switch_table[sw];
+	if (SW_HAS_DEVICE (swinfo))
+		return &device_nodes[SW_GET_DEVICE (swinfo)];
+	return &switch_nodes[sw];
+}
+
+
+/** Add a shot to the table.  Shots with more weight are made more often. */
+void autoplay_shot_add (unsigned int sw, unsigned int weight)
+{
+	if (shot_count == MAX_SHOTS || weight == 0)
+		return;
+	shot_table[shot_count].node = autoplay_switch_node (sw);
+	shot_table[shot_count].weight = weight;
+	shot_count++;
+	shot_weight_total += weight;
+}
+
+
+/** Choose a shot at random, according to the weights */
+static struct ball_node *autoplay_shot_choose (void)
+{
+	unsigned int n;
+	unsigned int r = autoplay_random (shot_weight_total);
+
+	for (n = 0; n < shot_count; n++)
+	{
+		if (r < shot_table[n].weight)
+			break;
+		r -= shot_table[n].weight;
+	}
+	return shot_table[n].node;
+}
+
+
+/** Release a flipper button after a flip */
+static void autoplay_flip_release (void *data)
+{
+	sim_switch_set ((unsigned long)data, 0);
+}
+
+
+/** Press one of the flipper buttons */
+static void autoplay_flip (void)
+{
+	unsigned long sw = autoplay_random (2) ? SW_RIGHT_BUTTON : SW_LEFT_BUTTON;
+
+	sim_switch_set (sw, 1);
+	sim_time_register (FLIP_TIME, FALSE, autoplay_flip_release, (void *)sw);
+	autoplay_flips++;
+}
+
+
+/** Handle the ball at the head of the playfield queue reaching the
+flippers. */
+static void autoplay_ball_at_flippers (void)
+{
+	struct ball_node *dst;
+
+	if (shot_weight_total > 0 && autoplay_random (100) < autoplay_skill)
+	{
+		autoplay_flip ();
+		dst = autoplay_shot_choose ();
+		if (!node_full_p (dst))
+		{
+			node_move (dst, &open_node);
+			return;
+		}
+		/* The shot cannot take another ball; it bounces back down
+		to the flippers and is tried again next time. */
+		node_move (&open_node, &open_node);
+	}
+	else
+	{
+		node_kick (&open_node);
+		autoplay_drains++;
+	}
+}
+
+
+/** Periodic handler that drives the balls while automatic play is on */
+static void autoplay_update (void *data)
+{
+	if (!autoplay_enabled)
+		return;
+
+	if (open_node.count > 0)
+	{
+		autoplay_flip_timer -= AUTOPLAY_TICK;
+		if (autoplay_flip_timer <= 0)
+		{
+			autoplay_ball_at_flippers ();
+
+			/* With more balls in play, one of them reaches the flippers
+			sooner. */
+			autoplay_flip_timer = autoplay_travel / 2 +
+				autoplay_random (autoplay_travel + 1);
+			if (open_node.count > 1)
+				autoplay_flip_timer /= open_node.count;
+		}
+	}
+
+#ifdef MACHINE_SHOOTER_SWITCH
+	if (shooter_node.count > 0)
+	{
+		autoplay_shooter_timer += AUTOPLAY_TICK;
+		if (autoplay_shooter_timer >= autoplay_plunge)
+		{
+#ifdef MACHINE_LAUNCH_SWITCH
+			sim_switch_set (MACHINE_LAUNCH_SWITCH, 1);
+			sim_time_register (FLIP_TIME, FALSE, autoplay_flip_release,
+				(void *)(unsigned long)MACHINE_LAUNCH_SWITCH);
+#else
+			node_kick (&shooter_node);
+#endif
+			autoplay_plunges++;
+			autoplay_shooter_timer = 0;
+		}
+	}
+	else
+		autoplay_shooter_timer = 0;
+#endif
+}
+
+
+/** Turn on automatic play */
+void autoplay_start (void)
+{
+	unsigned int sw;
+
+	/* Without any configured shots, any playfield switch will do */
+	if (shot_count == 0)
+	{
+		for (sw = 0; sw < NUM_SWITCHES; sw++)
+			if (switch_table[sw].flags & SW_PLAYFIELD)
+				autoplay_shot_add (sw, 1);
+	}
+
+	if (!autoplay_registered)
+	{
+		sim_time_register (AUTOPLAY_TICK, TRUE, autoplay_update, NULL);
+		autoplay_registered = 1;
+	}
+	autoplay_flip_timer = autoplay_travel;
+	autoplay_shooter_timer = 0;
+	autoplay_enabled = 1;
+	simlog (SLC_DEBUG, "Automatic play on, %d shots", shot_count);
+}
+
+
+/** Turn off automatic play.  Balls are left where they are. */
+void autoplay_stop (void)
+{
+	autoplay_enabled = 0;
+	simlog (SLC_DEBUG, "Automatic play off: %d flips, %d drains, %d plunges",
+		autoplay_flips, autoplay_drains, autoplay_plunges);
+}
+
+
+/** Make the automatic play settings available as conf variables */
+void autoplay_init (void)
+{
+	conf_add ("autoplay.skill", &autoplay_skill);
+	conf_add ("autoplay.travel", &autoplay_travel);
+	conf_add ("autoplay.plunge", &autoplay_plunge);
+	conf_add ("autoplay.flips", &autoplay_flips);
+	conf_add ("autoplay.drains", &autoplay_drains);
+	conf_add ("autoplay.plunges", &autoplay_plunges);
+}
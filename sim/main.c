@@ -36,10 +36,19 @@
 #include <freewpc.h>
 #include <simulation.h>
 #include <hwsim/io.h>
+#include <test.h>
+#include <highscore.h>
 
 extern void do_firq (void);
 extern void do_irq (void);
+extern int task_create_count;
+extern int realtime_turbo;
+extern void realtime_report (void);
 extern void exit (int);
+extern char protected_memory_file[];
+extern U16 random_cong_seed;
+extern struct audit standard_audits[];
+extern struct audit feature_audit_info[];
 
 
 /** The actual time at which the simulation was started */
@@ -78,6 +87,37 @@ int exec_late_flag = 0;
 
 int crash_on_error = 0;
 
+/** Files to record switch traces to, or replay them from */
+const char *swtrace_record_file = NULL;
+const char *swtrace_replay_file = NULL;
+
+#ifdef CONFIG_SWITCH_LATENCY
+/** If set, the switch latency statistics are written to this file,
+in CSV format, when the simulation exits */
+const char *latency_csv_file = NULL;
+#endif
+
+/** If set, the audits and high scores are written to this file
+when the simulation exits */
+const char *audit_report_file = NULL;
+
+/** If nonzero, the random number generator is started from this seed
+instead of the usual one, so that parallel runs do not all play the
+same game */
+unsigned int sim_random_seed = 0;
+
+/** The time that scripts/stresstest lets the machine play before it
+exits, in milliseconds */
+int sim_stress_time = 1800000;
+
+/** The maximum number of <var>=<value> settings on the command line */
+#define MAX_CONF_ARGS 8
+
+/** Conf settings given on the command line.  These are applied after
+the conf files are read, so they override them. */
+const char *conf_args[MAX_CONF_ARGS];
+int conf_arg_count = 0;
+
 
 /** Prints log messages, requested status, etc. to the console.
  * This is the only function that should use printf.
@@ -115,11 +155,112 @@ void simlog (enum sim_log_class class, const char *format, ...)
 }
 
 
+#ifdef CONFIG_SWITCH_LATENCY
+/** Write the switch latency statistics to a CSV file.  There is one
+line per switch/coil pair; times are in milliseconds, and the hist
+columns are the bucket counts (0-1, 2-3, 4-7, ... 128+). */
+static void sim_write_latency_csv (const char *filename)
+{
+	FILE *fp;
+	const switch_latency_pair_t *pair;
+	int n, bucket;
+
+	fp = fopen (filename, "w");
+	if (fp == NULL)
+	{
+		simlog (SLC_DEBUG, "Cannot write latency data to '%s'", filename);
+		return;
+	}
+
+	fprintf (fp, "switch,sw_name,sol,sol_name,count,min,avg,max,p99");
+	for (bucket = 0; bucket < SWITCH_LATENCY_BUCKETS; bucket++)
+		fprintf (fp, ",hist%d", bucket);
+	fprintf (fp, "\n");
+
+	for (n = 0; n < SWITCH_LATENCY_PAIRS; n++)
+	{
+		pair = &switch_latency_table[n];
+		if (pair->sw == SWITCH_LATENCY_NONE)
+			continue;
+		fprintf (fp, "%d,\"%s\",%d,\"%s\",%d,%d,%d,%d,%d",
+			pair->sw, names_of_switches[pair->sw],
+			pair->sol, names_of_drives[pair->sol],
+			pair->count, pair->min, switch_latency_average (pair),
+			pair->max, switch_latency_p99 (pair));
+		for (bucket = 0; bucket < SWITCH_LATENCY_BUCKETS; bucket++)
+			fprintf (fp, ",%d", pair->hist[bucket]);
+		fprintf (fp, "\n");
+	}
+	fclose (fp);
+	simlog (SLC_DEBUG, "Wrote latency data to '%s' (%d dropped)",
+		filename, switch_latency_dropped);
+}
+#endif
+
+
+/** Write one list of audits to the report.  Only the integer counters
+are written; the percentages and averages can be derived from them. */
+static void sim_write_audit_list (FILE *fp, const struct audit *aud)
+{
+	for (; aud->name != NULL; aud++)
+	{
+		if (aud->nvram && aud->format == AUDIT_TYPE_INT)
+			fprintf (fp, "%s\t%d\n", aud->name, *aud->nvram);
+	}
+}
+
+
+/** Write the audits and the high score table to a file.  There is
+one "name<tab>value" line per audit, so that the reports from many
+runs can be summed up by tools/native_batch. */
+static void sim_write_audit_report (const char *filename)
+{
+	FILE *fp;
+
+	fp = fopen (filename, "w");
+	if (fp == NULL)
+	{
+		simlog (SLC_DEBUG, "Cannot write audit report to '%s'", filename);
+		return;
+	}
+
+	fprintf (fp, "MACHINE\t%s\n", MACHINE_SHORTNAME);
+	fprintf (fp, "SEED\t%d\n", sim_random_seed);
+	fprintf (fp, "SIM MINUTES\t%ld\n", realtime_read () / 60000);
+	sim_write_audit_list (fp, standard_audits);
+	sim_write_audit_list (fp, feature_audit_info);
+#ifdef CONFIG_PLATFORM_WPC
+	high_score_write_report (fp);
+#endif
+	fclose (fp);
+	simlog (SLC_DEBUG, "Wrote audit report to '%s'", filename);
+}
+
+
+/** Apply the random seed from the command-line.  This must wait until
+the kernel has initialized its own seed. */
+CALLSET_ENTRY (sim, init_complete)
+{
+	if (sim_random_seed)
+		random_cong_seed = sim_random_seed;
+}
+
+
 /*	Called to shutdown the simulation.
 	This performs all cleanup before exiting back to the native OS. */
 __noreturn__ void sim_exit (U8 error_code)
 {
 	simlog (SLC_DEBUG, "Shutting down simulation.");
+	if (realtime_turbo || linux_irq_multiplier != 1)
+		realtime_report ();
+	sim_swtrace_stop ();
+	signal_capture_set_file (NULL);
+#ifdef CONFIG_SWITCH_LATENCY
+	if (latency_csv_file)
+		sim_write_latency_csv (latency_csv_file);
+#endif
+	if (audit_report_file)
+		sim_write_audit_report (audit_report_file);
 	protected_memory_save ();
 	ui_exit ();
 	if (crash_on_error && error_code)
@@ -175,7 +316,10 @@ CALLSET_ENTRY (sim, realtime_tick)
 unsigned int
 sim_get_wall_clock (void)
 {
-	time_t now = time (NULL);
+	time_t now;
+	if (realtime_turbo)
+		return realtime_read () / 60000;
+	now = time (NULL);
 	return ((now - sim_boot_time) * linux_irq_multiplier) / 60;
 }
 
@@ -226,6 +370,16 @@ int main (int argc, char *argv[])
 			printf ("-o <file>           Log debug messages to file (default : stdout)\n");
 			printf ("--debuginit         Wait for GDB attach during init (default: no)\n");
 			printf ("--exec <file>       Read script commands from file\n");
+			printf ("--record <file>     Record all switch changes to file\n");
+			printf ("--replay <file>     Replay switch changes from file, then exit\n");
+			printf ("--turbo             Run the simulated clock as fast as possible\n");
+			printf ("--nvram <file>      Load/save protected memory to file\n");
+			printf ("--seed <n>          Start the random number generator at n\n");
+			printf ("--audit-report <file> Write audits and high scores to file on exit\n");
+			printf ("<var>=<value>       Set a conf variable\n");
+#ifdef CONFIG_SWITCH_LATENCY
+			printf ("--latency-csv <file> Write switch latency data to file on exit\n");
+#endif
 			exit (0);
 		}
 		else if (!strcmp (arg, "-f"))
@@ -249,6 +403,43 @@ int main (int argc, char *argv[])
 		{
 			exec_file = argv[argn++];
 		}
+#ifdef CONFIG_SWITCH_LATENCY
+		else if (!strcmp (arg, "--latency-csv"))
+		{
+			latency_csv_file = argv[argn++];
+		}
+#endif
+		else if (!strcmp (arg, "--record"))
+		{
+			swtrace_record_file = argv[argn++];
+		}
+		else if (!strcmp (arg, "--replay"))
+		{
+			swtrace_replay_file = argv[argn++];
+		}
+		else if (!strcmp (arg, "--turbo"))
+		{
+			realtime_turbo = 1;
+		}
+		else if (!strcmp (arg, "--nvram"))
+		{
+			strncpy (protected_memory_file, argv[argn++], 255);
+		}
+		else if (!strcmp (arg, "--seed"))
+		{
+			unsigned long seed = strtoul (argv[argn++], NULL, 0);
+			if (seed == 0 || seed > 0xFFFF)
+			{
+				printf ("Error: seed must be from 1 to 65535\n");
+				exit (1);
+			}
+			sim_random_seed = seed;
+			srand (sim_random_seed);
+		}
+		else if (!strcmp (arg, "--audit-report"))
+		{
+			audit_report_file = argv[argn++];
+		}
 		else if (!strcmp (arg, "--late"))
 		{
 			exec_late_flag = 1;
@@ -259,15 +450,12 @@ int main (int argc, char *argv[])
 		}
 		else if (strchr (arg, '='))
 		{
-			char varval[64];
-			unsigned int val;
-			char *s;
-
-			strcpy (varval, arg);
-			s = strchr (varval, '=');
-			*s = '\0';
-			val = strtoul (s+1, NULL, 0);
-			//conf_set_later (varval, val);
+			if (conf_arg_count == MAX_CONF_ARGS)
+			{
+				printf ("Error: too many conf settings\n");
+				exit (1);
+			}
+			conf_args[conf_arg_count++] = arg;
 		}
 		else
 		{
@@ -321,6 +509,13 @@ int main (int argc, char *argv[])
 	sim_switch_toggle (SW_COIN_DOOR_CLOSED);
 #endif
 
+	/* Start recording or replaying switches.  This is done after the
+	initial switch levels are set, which are the same every time. */
+	if (swtrace_record_file)
+		sim_swtrace_record (swtrace_record_file);
+	if (swtrace_replay_file)
+		sim_swtrace_replay (swtrace_replay_file);
+
 	/* Load the protected memory area */
 	protected_memory_load ();
 
@@ -347,13 +542,30 @@ int main (int argc, char *argv[])
 	/* Create more conf knobs */
 	conf_add ("balls", &sim_installed_balls);
 	conf_add ("sim.speed", &linux_irq_multiplier);
+	conf_add ("task.created", &task_create_count);
+	conf_add ("stress.time", &sim_stress_time);
+	autoplay_init ();
 
 	/* Execute default script file.  First, load any global
 	configuration in freewpc.conf.  Then, try to load a
-	game-specific file, based on its shortname.  Last,
-	execute any file provided on the command line. */
+	game-specific file, based on its shortname.  Then apply
+	any settings from the command line.  Last, execute any file
+	provided on the command line. */
 	exec_script_file ("conf/freewpc.conf");
 	exec_script_file ("conf/" MACHINE_SHORTNAME ".conf");
+	for (argn = 0; argn < conf_arg_count; argn++)
+	{
+		char varval[64];
+		char *s;
+
+		strncpy (varval, conf_args[argn], sizeof (varval) - 1);
+		varval[sizeof (varval) - 1] = '\0';
+		s = strchr (varval, '=');
+		if (s == NULL)
+			continue;
+		*s = '\0';
+		conf_write (varval, strtoul (s+1, NULL, 0));
+	}
 	if (exec_file && !exec_late_flag)
 		exec_script_file (exec_file);
 
@@ -228,18 +228,33 @@ struct signal_expression *texpr (void)
 }
 
 
-uint32_t tsw (void)
+/**
+ * Return the number of the switch with the given name, or NUM_SWITCHES
+ * if there is no such switch.
+ */
+static uint32_t tswname (const char *t)
 {
-	const char *t;
 	uint32_t n;
 
-	t = tstring ();
-	for (n=0; n < NUM_SWITCHES; n++)
+	for (n=0; t && n < NUM_SWITCHES; n++)
 	{
 		const char *swname = names_of_switches[n];
 		if (swname && !strcmp (swname, t))
 			return n;
 	}
+	return NUM_SWITCHES;
+}
+
+
+uint32_t tsw (void)
+{
+	const char *t;
+	uint32_t n;
+
+	t = tstring ();
+	n = tswname (t);
+	if (n < NUM_SWITCHES)
+		return n;
 	tunget (t);
 	return tconst ();
 }
@@ -286,6 +301,11 @@ void exec_script (char *cmd)
 			t = tnext ();
 			signal_capture_set_file (t);
 		}
+		else if (teq (t, "format"))
+		{
+			t = tnext ();
+			signal_capture_set_format (t);
+		}
 		else if (teq (t, "add"))
 		{
 			signal_capture_add (tsigno ());
@@ -349,6 +369,35 @@ void exec_script (char *cmd)
 		simlog (SLC_DEBUG, "Key '%c' = %s", *t, names_of_switches[v]);
 		sim_key_install (*t, v);
 	}
+	/*********** autoplay [on|off|shot] [args...] ***************/
+	else if (teq (t, "autoplay"))
+	{
+		t = tnext ();
+		if (teq (t, "on"))
+		{
+			autoplay_start ();
+		}
+		else if (teq (t, "off"))
+		{
+			autoplay_stop ();
+		}
+		else if (teq (t, "shot"))
+		{
+			/* Only switch names are accepted here, so that a misspelled
+			name is not taken as switch 0. */
+			t = tstring ();
+			v = tswname (t);
+			if (v == NUM_SWITCHES)
+			{
+				simlog (SLC_DEBUG, "autoplay: no switch named '%s'", t ? t : "");
+				return;
+			}
+			count = tconst ();
+			if (count == 0)
+				count = 1;
+			autoplay_shot_add (v, count);
+		}
+	}
 	/*********** push [value] ***************/
 	else if (teq (t, "push"))
 	{
@@ -37,8 +37,9 @@ extern char *__start_nvram, *__stop_nvram;
 extern char *__start_local, *__stop_local;
 
 
-/** The name of the backing file */
-char protected_memory_file[256] = "nvram/default.nv";
+/** The name of the backing file.  If not given on the command-line,
+a default based on the machine name is used. */
+char protected_memory_file[256] = "";
 
 
 /** Load the contents of the protected memory from file to RAM. */
@@ -48,7 +49,8 @@ void protected_memory_load (void)
 	FILE *fp;
 
 	/* Use a different file for each machine */
-	sprintf (protected_memory_file, "nvram/%s.nv", MACHINE_SHORTNAME);
+	if (protected_memory_file[0] == '\0')
+		sprintf (protected_memory_file, "nvram/%s.nv", MACHINE_SHORTNAME);
 
 	simlog (SLC_DEBUG, "Loading protected memory from '%s'", protected_memory_file);
 	fp = fopen (protected_memory_file, "r");
@@ -28,12 +28,56 @@
  * The signal module allows 'scoping' of binary I/O signals
  * and writing the results to a file which can be converted into
  * a waveform.
+ *
+ * The capture file is written in one of two formats.  The text format
+ * has a line for every millisecond, giving the time and the value of
+ * each captured signal.  The binary format only records changes, and
+ * is much smaller and faster to write for long captures.  It is
+ * made up of one or more segments, one for each time that capture
+ * starts, each of which is:
+ *
+ *    "FWSG"          magic number
+ *    u8              format version, currently 1
+ *    u8              number of captured signals, N
+ *    u32 * N         the signal numbers
+ *    u64             the time that capture started
+ *
+ * followed by a series of records:
+ *
+ *    varint          time since the last record (or the start)
+ *    u8              number of changes that follow, or 0xFF at the
+ *                    end of the segment
+ *    u8              for each change, the column number in the low
+ *                    4 bits, plus SIGCAP_ZERO, SIGCAP_ONE or
+ *                    SIGCAP_DOUBLE; the last is followed by the
+ *                    value as a u64 holding the IEEE bits.
+ *
+ * All multibyte values are little-endian, and varints use 7 bits per
+ * byte, least significant first, with 0x80 set on all but the last.
+ * The first record gives the value of every signal.  tools/sigconv
+ * converts a binary capture into the text format.
  */
 
 #define MAX_READINGS 256
 #define MAX_CAPTURES 16
 #define MAX_EXPR 8
 
+/** The maximum number of instructions in a compiled trigger */
+#define MAX_PROGRAM 32
+
+/** A signal number which matches no signal, used when checking
+triggers other than because of a signal change */
+#define SIGNO_NONE 0xFFFFFFFFUL
+
+#define SIGCAP_VERSION 1
+#define SIGCAP_ZERO 0x00
+#define SIGCAP_ONE 0x10
+#define SIGCAP_DOUBLE 0x20
+#define SIGCAP_END 0xFF
+
+/** The amount of stdio buffering given to the capture file */
+#define SIGCAP_BUFFER_SIZE 65536
+
 /**
  * A structure for tracking a single binary signal over a period
  * of time.
@@ -74,10 +118,47 @@ uint32_t signals_being_captured[MAX_CAPTURES];
 /** The output file when capturing is enabled */
 FILE *signal_capture_file;
 
-signal_expression_t *signal_start_expr, *signal_stop_expr;
+/**
+ * Trigger expressions are compiled into a postfix program when they
+ * are set, rather than walking the expression tree each time that a
+ * signal changes.  Each instruction reuses the operator of the tree
+ * node that it came from.  Leaf instructions push one truth value,
+ * and SIG_AND, SIG_OR and SIG_NOT combine the ones on the stack.
+ */
+typedef struct signal_insn
+{
+	enum signal_operator op;
+	uint32_t signo;
+	uint64_t value;
+} signal_insn_t;
+
+typedef struct signal_program
+{
+	unsigned int len;
+	signal_insn_t insn[MAX_PROGRAM];
+} signal_program_t;
+
+signal_program_t *signal_start_prog, *signal_stop_prog;
+
+/**
+ * The signals that either trigger refers to.  The triggers are only
+ * checked when one of these changes, and once per tick for the time
+ * terms; see signal_trace_periodic().  A trigger with a 'not' watches
+ * every signal, since any change to another signal can make it true.
+ */
+uint32_t signal_watch[(MAX_SIGNALS + 31) / 32] = { 0, };
 
 int signal_capture_active = 0;
 
+/** Nonzero if the capture file is written in the binary format */
+int signal_capture_binary = 0;
+
+/** In a binary capture, the value last written for each column */
+double signal_capture_values[MAX_CAPTURES];
+
+/** In a binary capture, the time of the last record */
+uint64_t signal_capture_last_time;
+
 uint64_t signal_trace_start_time;
 
 
@@ -181,64 +262,284 @@ static signal_readings_t *signal_chunk_alloc (void)
 
 
 /**
- * Evaluate a signal expression.  The script parser converts the textual
- * expression into a parse tree, passed in EX.  SIG_CHANGED says whether or
- * not the current signal being scanned changed during the last time step.
+ * Add the instructions for expression EX to the end of PROG.
+ * Returns zero if the program would be too long.
  */
-bool signal_expr_eval (unsigned int sig_changed, struct signal_expression *ex)
+static int signal_compile (signal_program_t *prog, struct signal_expression *ex)
 {
+	signal_insn_t *insn;
+
+	if (ex && expr_binary_p (ex) && ex->op != SIG_EQ)
+	{
+		if (!signal_compile (prog, ex->u.binary.left)
+			|| !signal_compile (prog, ex->u.binary.right))
+			return 0;
+	}
+	else if (ex && ex->op == SIG_NOT)
+	{
+		if (!signal_compile (prog, ex->u.unary))
+			return 0;
+	}
+
+	if (prog->len == MAX_PROGRAM)
+		return 0;
+	insn = &prog->insn[prog->len++];
+	insn->signo = SIGNO_NONE;
+	insn->value = 0;
+
+	/* A missing expression is never true */
 	if (!ex)
-		return FALSE;
+	{
+		insn->op = SIG_CONST;
+		return 1;
+	}
 
+	insn->op = ex->op;
 	switch (ex->op)
 	{
-		default:
-			return FALSE;
-
-		/* A signal name without any qualification is true when its value
-		changes */
 		case SIG_SIGNO:
-			if (ex->u.signo == sig_changed)
-				return TRUE;
+			insn->signo = ex->u.signo;
 			break;
-
+		case SIG_TIME:
 		case SIG_TIMEDIFF:
-			if (realtime_read () >= signal_trace_start_time + ex->u.value)
-				return TRUE;
+			insn->value = ex->u.timer;
 			break;
-
-		case SIG_TIME:
-			if (realtime_read () >= ex->u.value)
-				return TRUE;
+		case SIG_CONST:
+			insn->value = ex->u.value;
 			break;
-
-		/* Indicates a "<signal> is <value>" expression.  True if
-		the signal has the exact value */
 		case SIG_EQ:
-			if (ex->u.binary.left->u.signo == sig_changed
-				&& signal_readings[sig_changed]->prev_state ==
-					ex->u.binary.right->u.value)
-				return TRUE;
+			insn->signo = ex->u.binary.left->u.signo;
+			insn->value = ex->u.binary.right->u.value;
 			break;
-
-		case SIG_AND:
-			if (signal_expr_eval (sig_changed, ex->u.binary.left)
-				&& signal_expr_eval (sig_changed, ex->u.binary.right))
-				return TRUE;
+		default:
 			break;
+	}
+	return 1;
+}
 
-		case SIG_OR:
-			if (signal_expr_eval (sig_changed, ex->u.binary.left)
-				|| signal_expr_eval (sig_changed, ex->u.binary.right))
-				return TRUE;
-			break;
 
-		case SIG_NOT:
-			if (!signal_expr_eval (sig_changed, ex->u.unary))
-				return TRUE;
-			break;
+/**
+ * Compile a trigger expression.  The expression tree is freed.
+ */
+static signal_program_t *signal_program_create (struct signal_expression *ex)
+{
+	signal_program_t *prog;
+
+	if (!ex)
+		return NULL;
+	prog = malloc (sizeof (signal_program_t));
+	if (!prog)
+	{
+		simlog (SLC_DEBUG, "Out of memory for trigger expression.");
+		expr_free (ex);
+		return NULL;
+	}
+	prog->len = 0;
+	if (!signal_compile (prog, ex))
+	{
+		simlog (SLC_DEBUG, "Trigger expression is too long.");
+		free (prog);
+		prog = NULL;
+	}
+	expr_free (ex);
+	return prog;
+}
+
+
+/**
+ * Rebuild the list of signals that the triggers refer to.
+ */
+static void signal_watch_update (void)
+{
+	signal_program_t *progs[2] = { signal_start_prog, signal_stop_prog };
+	unsigned int p, n;
+
+	memset (signal_watch, 0, sizeof (signal_watch));
+	for (p = 0; p < 2; p++)
+	{
+		if (!progs[p])
+			continue;
+		for (n = 0; n < progs[p]->len; n++)
+		{
+			uint32_t signo = progs[p]->insn[n].signo;
+			if (progs[p]->insn[n].op == SIG_NOT)
+			{
+				memset (signal_watch, 0xFF, sizeof (signal_watch));
+				return;
+			}
+			if (signo < MAX_SIGNALS)
+				signal_watch[signo / 32] |= (1U << (signo % 32));
+		}
+	}
+}
+
+
+static inline bool signal_watched (uint32_t signo)
+{
+	return (signal_watch[signo / 32] & (1U << (signo % 32))) != 0;
+}
+
+
+/**
+ * Run a compiled trigger.  SIG_CHANGED says which signal just changed
+ * state, or SIGNO_NONE.  A signal name on its own is true when it is
+ * the one that changed; "<signal> is <value>" also requires it to have
+ * changed to that value.  A 'not' is only true when some signal really
+ * changed, so that it does not fire on the periodic check.
+ */
+static bool signal_program_run (const signal_program_t *prog, uint32_t sig_changed)
+{
+	bool stack[MAX_PROGRAM];
+	unsigned int sp = 0;
+	const signal_insn_t *insn;
+
+	for (insn = prog->insn; insn < prog->insn + prog->len; insn++)
+	{
+		switch (insn->op)
+		{
+			case SIG_SIGNO:
+				stack[sp++] = (insn->signo == sig_changed);
+				break;
+
+			case SIG_TIME:
+				stack[sp++] = (realtime_read () >= insn->value);
+				break;
+
+			case SIG_TIMEDIFF:
+				stack[sp++] =
+					(realtime_read () >= signal_trace_start_time + insn->value);
+				break;
+
+			case SIG_EQ:
+				stack[sp++] = (insn->signo == sig_changed
+					&& signal_value (sig_changed) == insn->value);
+				break;
+
+			case SIG_AND:
+				sp--;
+				stack[sp-1] = stack[sp-1] && stack[sp];
+				break;
+
+			case SIG_OR:
+				sp--;
+				stack[sp-1] = stack[sp-1] || stack[sp];
+				break;
+
+			case SIG_NOT:
+				stack[sp-1] = !stack[sp-1] && sig_changed != SIGNO_NONE;
+				break;
+
+			case SIG_CONST:
+			default:
+				stack[sp++] = (insn->value != 0);
+				break;
+		}
+	}
+	return stack[0];
+}
+
+
+static void signal_put_u32 (uint32_t val)
+{
+	int n;
+	for (n = 0; n < 4; n++, val >>= 8)
+		putc (val & 0xFF, signal_capture_file);
+}
+
+
+static void signal_put_u64 (uint64_t val)
+{
+	int n;
+	for (n = 0; n < 8; n++, val >>= 8)
+		putc (val & 0xFF, signal_capture_file);
+}
+
+
+static void signal_put_varint (uint64_t val)
+{
+	while (val >= 0x80)
+	{
+		putc ((val & 0x7F) | 0x80, signal_capture_file);
+		val >>= 7;
+	}
+	putc (val, signal_capture_file);
+}
+
+
+/**
+ * Write the header of a binary capture segment, and a first record
+ * with the values of all of the signals.
+ */
+static void signal_write_binary_header (void)
+{
+	int sigin, count;
+
+	fputs ("FWSG", signal_capture_file);
+	putc (SIGCAP_VERSION, signal_capture_file);
+	for (sigin = 0, count = 0; sigin < MAX_CAPTURES; sigin++)
+		if (signals_being_captured[sigin])
+			count++;
+	putc (count, signal_capture_file);
+	for (sigin = 0; sigin < MAX_CAPTURES; sigin++)
+		if (signals_being_captured[sigin])
+			signal_put_u32 (signals_being_captured[sigin]);
+	signal_put_u64 (realtime_read ());
+	signal_capture_last_time = realtime_read ();
+
+	/* Make every value look changed, so the first record
+	includes them all */
+	for (sigin = 0; sigin < MAX_CAPTURES; sigin++)
+		signal_capture_values[sigin] = NAN;
+}
+
+
+/**
+ * Write a binary capture record, for the signals that have changed
+ * since the last one.  Nothing is written if none have.
+ */
+static void signal_write_binary (void)
+{
+	int sigin, col, count;
+	double value[MAX_CAPTURES];
+	uint64_t bits;
+
+	for (sigin = 0, count = 0; sigin < MAX_CAPTURES; sigin++)
+	{
+		uint32_t signo = signals_being_captured[sigin];
+		if (signo)
+		{
+			value[sigin] = signal_value (signo);
+			if (value[sigin] != signal_capture_values[sigin])
+				count++;
+		}
+	}
+	if (count == 0)
+		return;
+
+	signal_put_varint (realtime_read () - signal_capture_last_time);
+	signal_capture_last_time = realtime_read ();
+	putc (count, signal_capture_file);
+
+	for (sigin = 0, col = 0; sigin < MAX_CAPTURES; sigin++)
+	{
+		if (!signals_being_captured[sigin])
+			continue;
+		if (value[sigin] != signal_capture_values[sigin])
+		{
+			signal_capture_values[sigin] = value[sigin];
+			if (value[sigin] == 0.0)
+				putc (col | SIGCAP_ZERO, signal_capture_file);
+			else if (value[sigin] == 1.0)
+				putc (col | SIGCAP_ONE, signal_capture_file);
+			else
+			{
+				putc (col | SIGCAP_DOUBLE, signal_capture_file);
+				memcpy (&bits, &value[sigin], sizeof (bits));
+				signal_put_u64 (bits);
+			}
+		}
+		col++;
 	}
-	return FALSE;
 }
 
 
@@ -249,6 +550,13 @@ bool signal_expr_eval (unsigned int sig_changed, struct signal_expression *ex)
 void signal_write_header (void)
 {
 	int sigin;
+
+	if (signal_capture_binary)
+	{
+		signal_write_binary_header ();
+		return;
+	}
+
 	fprintf (signal_capture_file, "# Time");
 	for (sigin = 0; sigin < MAX_CAPTURES; sigin++)
 	{
@@ -266,6 +574,13 @@ void signal_write_header (void)
 void signal_write (void)
 {
 	int sigin;
+
+	if (signal_capture_binary)
+	{
+		signal_write_binary ();
+		return;
+	}
+
 	fprintf (signal_capture_file, "%lu", realtime_read ());
 	for (sigin = 0; sigin < MAX_CAPTURES; sigin++)
 	{
@@ -280,6 +595,49 @@ void signal_write (void)
 }
 
 
+/**
+ * End the capture that is in progress.
+ */
+static void signal_capture_finish (void)
+{
+	if (signal_capture_binary)
+	{
+		signal_put_varint (realtime_read () - signal_capture_last_time);
+		putc (SIGCAP_END, signal_capture_file);
+	}
+	fflush (signal_capture_file);
+	signal_capture_active = 0;
+}
+
+
+/**
+ * Check whether capture should start or stop.  SIG_CHANGED says
+ * which signal just changed, or SIGNO_NONE.
+ */
+static void signal_capture_check (uint32_t sig_changed)
+{
+	if (signal_capture_active && signal_capture_file)
+	{
+		/* Also see if tracing should stop */
+		if (signal_stop_prog && signal_program_run (signal_stop_prog, sig_changed))
+		{
+			simlog (SLC_DEBUG, "Capture complete.");
+			signal_capture_finish ();
+		}
+	}
+	else if (signal_start_prog && signal_program_run (signal_start_prog, sig_changed))
+	{
+		/* Otherwise, should capture start now because we meet the start
+		condition? */
+		simlog (SLC_DEBUG, "Capture started.");
+		signal_capture_active = 1;
+		signal_trace_start_time = realtime_read ();
+		signal_write_header ();
+		signal_write ();
+	}
+}
+
+
 /**
  * Update the state of a binary signal.  SIGNO says which signal,
  * STATE is a zero/nonzero value reflecting its binary state.
@@ -300,7 +658,7 @@ void signal_update (signal_number_t signo, unsigned int state)
 	/* Don't do anything else if we're not tracing this signal. */
 	sigrd = signal_readings[signo];
 	if (!sigrd)
-		goto do_capture;
+		goto check_triggers;
 
 	/* Move to the last block in the list of signal data. */
 	while (sigrd->next)
@@ -340,27 +698,12 @@ void signal_update (signal_number_t signo, unsigned int state)
 	sigrd->t[sigrd->count++] = realtime_read ();
 	sigrd->prev_state = state;
 
-do_capture:
-	if (signal_capture_active && signal_capture_file)
-	{
-		/* Also see if tracing should stop */
-		if (signal_stop_expr && signal_expr_eval (signo, signal_stop_expr))
-		{
-			simlog (SLC_DEBUG, "Capture complete.");
-			fflush (signal_capture_file);
-			signal_capture_active = 0;
-		}
-	}
-	else if (signal_start_expr && signal_expr_eval (signo, signal_start_expr))
-	{
-		/* Otherwise, should capture start now because we meet the start
-		condition? */
-		simlog (SLC_DEBUG, "Capture started.");
-		signal_capture_active = 1;
-		signal_trace_start_time = realtime_read ();
-		signal_write_header ();
-		signal_write ();
-	}
+check_triggers:
+	/* A change to a signal that no trigger mentions cannot make
+	one true, except through a time, and that is covered by the check
+	in signal_trace_periodic(). */
+	if (signal_watched (signo))
+		signal_capture_check (signo);
 }
 
 
@@ -370,10 +713,11 @@ do_capture:
  */
 void signal_capture_start (struct signal_expression *ex)
 {
-	if (signal_start_expr)
-		expr_free (signal_start_expr);
-	signal_start_expr = ex;
-	simlog (SLC_DEBUG, "Capture start condition set. %p", signal_start_expr);
+	if (signal_start_prog)
+		free (signal_start_prog);
+	signal_start_prog = signal_program_create (ex);
+	signal_watch_update ();
+	simlog (SLC_DEBUG, "Capture start condition set. %p", signal_start_prog);
 }
 
 
@@ -384,10 +728,11 @@ void signal_capture_start (struct signal_expression *ex)
  */
 void signal_capture_stop (struct signal_expression *ex)
 {
-	if (signal_stop_expr)
-		expr_free (signal_stop_expr);
+	if (signal_stop_prog)
+		free (signal_stop_prog);
 	simlog (SLC_DEBUG, "Capture stop condition set.");
-	signal_stop_expr = ex;
+	signal_stop_prog = signal_program_create (ex);
+	signal_watch_update ();
 }
 
 
@@ -431,21 +776,14 @@ void signal_capture_del (uint32_t signo)
 /**
  * The periodic handler runs every millisecond.  If a capture is active,
  * it writes out the values of all signals being traced in this time step.
- * If a stop expression has been defined, then it also checks to see if
- * tracing should finish.
+ * It also checks the triggers as if no signal had changed, which
+ * handles the ones that depend on time.
  */
 static void signal_trace_periodic (void *data __attribute__((unused)))
 {
 	if (signal_capture_active)
-	{
 		signal_write ();
-		if (signal_stop_expr && signal_expr_eval (0, signal_stop_expr))
-		{
-			simlog (SLC_DEBUG, "Capture complete in periodic.");
-			fflush (signal_capture_file);
-			signal_capture_active = 0;
-		}
-	}
+	signal_capture_check (SIGNO_NONE);
 }
 
 
@@ -458,14 +796,33 @@ void signal_capture_set_file (const char *filename)
 	if (filename)
 	{
 		signal_capture_file = fopen (filename, "w");
+		if (signal_capture_file)
+			setvbuf (signal_capture_file, NULL, _IOFBF, SIGCAP_BUFFER_SIZE);
 	}
 	else if (signal_capture_file)
 	{
+		if (signal_capture_active)
+			signal_capture_finish ();
 		fclose (signal_capture_file);
+		signal_capture_file = NULL;
 	}
 }
 
 
+/**
+ * Set the format of the capture file, either "text" or "binary".
+ */
+void signal_capture_set_format (const char *format)
+{
+	if (format && !strcmp (format, "binary"))
+		signal_capture_binary = 1;
+	else if (format && !strcmp (format, "text"))
+		signal_capture_binary = 0;
+	else
+		simlog (SLC_DEBUG, "Unknown capture format.");
+}
+
+
 /**
  * Enable tracing for a signal.
  */
@@ -510,7 +867,7 @@ void signal_trace_stop (signal_number_t signo)
  */
 void signal_init (void)
 {
-	signal_start_expr = signal_stop_expr = NULL;
+	signal_start_prog = signal_stop_prog = NULL;
 	signal_capture_active = 0;
 	sim_time_register (1, TRUE, signal_trace_periodic, NULL);
 }
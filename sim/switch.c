@@ -52,11 +52,16 @@ static void sim_switch_update (int sw)
 
 	/* Update the signal tracker */
 	signal_update (SIGNO_SWITCH + sw, !!level);
+
+	/* Update the switch trace, if recording */
+	sim_swtrace_switch (sw, level);
 }
 
 
 void sim_switch_toggle (int sw)
 {
+	if (sim_swtrace_replaying)
+		return;
 	if (sim_no_switch_power)
 		return;
 	if (sim_no_opto_power && switch_is_opto (sw))
@@ -68,6 +73,8 @@ void sim_switch_toggle (int sw)
 
 void sim_switch_set (int sw, int on)
 {
+	if (sim_swtrace_replaying)
+		return;
 	if (sim_no_switch_power)
 		return;
 	if (sim_no_opto_power && switch_is_opto (sw))
@@ -83,6 +90,18 @@ void sim_switch_set (int sw, int on)
 }
 
 
+/** Set the raw level of a switch from a replayed trace.  This is the
+only way to change a switch while a trace is being replayed. */
+void sim_switch_replay (int sw, int level)
+{
+	if (level)
+		sim_switch_matrix[sw / 8] |= (1 << (sw % 8));
+	else
+		sim_switch_matrix[sw / 8] &= ~(1 << (sw % 8));
+	sim_switch_update (sw);
+}
+
+
 int sim_switch_read (int sw)
 {
 	return sim_switch_matrix[sw/8] & (1 << (sw%8));
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * \file
+ * \brief Record and replay switch traces.
+ *
+ * A trace is every change to the simulated switch matrix, with the
+ * simulation time at which it happened.  It is captured with --record
+ * and played back with --replay.  During playback, the trace is the only
+ * source of switch input: the keyboard, scripts and the ball simulation
+ * cannot change the switches, so the game code sees exactly what it saw
+ * when the trace was made.  The simulation exits shortly after the
+ * trace ends, reporting how long the replay took.
+ *
+ * The file format is a header, then one record per change:
+ *
+ *    "FWST" version(1) switch-count(1) machine-name NUL
+ *    delta-time(varint) switch(1)
+ *
+ * The delta time is in milliseconds since the previous record, written
+ * 7 bits per byte, low bits first, with the high bit set on all but the
+ * last byte.  The switch byte holds the switch number in the low 7 bits
+ * and the new raw matrix level in the high bit.
+ */
+
+#include <freewpc.h>
+#include <simulation.h>
+#include <sys/time.h>
+
+#define SWTRACE_MAGIC "FWST"
+#define SWTRACE_VERSION 1
+#define SWTRACE_LEVEL 0x80
+
+/** The file being recorded, if any */
+static FILE *swtrace_record_fp;
+
+/** The simulation time of the last recorded change */
+static unsigned long swtrace_record_time;
+
+/** The number of changes recorded */
+static unsigned long swtrace_record_count;
+
+/** The trace being replayed, read entirely into memory */
+static U8 *swtrace_replay_data;
+static U8 *swtrace_replay_pos;
+static U8 *swtrace_replay_end;
+
+/** The simulation time at which the next replayed change is due */
+static unsigned long swtrace_replay_time;
+
+/** The number of changes replayed */
+static unsigned long swtrace_replay_count;
+
+/** How long to keep running after the last replayed change, so
+ * that the game can react to it */
+#define SWTRACE_REPLAY_LINGER 2000
+
+/** The simulation and wall clock times when replay started */
+static unsigned long swtrace_replay_begin;
+static struct timeval swtrace_replay_start;
+
+/** Nonzero while a replay is in progress */
+int sim_swtrace_replaying;
+
+
+/** Write a value in the variable-length format */
+static void swtrace_write_varint (unsigned long val)
+{
+	while (val >= 0x80)
+	{
+		fputc ((val & 0x7F) | 0x80, swtrace_record_fp);
+		val >>= 7;
+	}
+	fputc (val, swtrace_record_fp);
+}
+
+
+/** Read a value in the variable-length format.  Returns zero if the
+ * trace ends in the middle of it. */
+static int swtrace_read_varint (unsigned long *valp)
+{
+	unsigned long val = 0;
+	int shift = 0;
+	U8 c;
+
+	do {
+		if (swtrace_replay_pos >= swtrace_replay_end)
+			return 0;
+		c = *swtrace_replay_pos++;
+		val |= (unsigned long)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	*valp = val;
+	return 1;
+}
+
+
+/** Called by the switch simulation on every change to the matrix */
+void sim_swtrace_switch (int sw, int level)
+{
+	unsigned long now;
+
+	if (!swtrace_record_fp)
+		return;
+	now = realtime_read ();
+	swtrace_write_varint (now - swtrace_record_time);
+	fputc (sw | (level ? SWTRACE_LEVEL : 0), swtrace_record_fp);
+	swtrace_record_time = now;
+	swtrace_record_count++;
+}
+
+
+/** Start recording a trace to a file */
+void sim_swtrace_record (const char *filename)
+{
+	swtrace_record_fp = fopen (filename, "wb");
+	if (!swtrace_record_fp)
+	{
+		simlog (SLC_DEBUG, "Cannot record to '%s'", filename);
+		sim_exit (1);
+	}
+	fputs (SWTRACE_MAGIC, swtrace_record_fp);
+	fputc (SWTRACE_VERSION, swtrace_record_fp);
+	fputc (NUM_SWITCHES, swtrace_record_fp);
+	fputs (MACHINE_SHORTNAME, swtrace_record_fp);
+	fputc ('\0', swtrace_record_fp);
+	swtrace_record_time = realtime_read ();
+	simlog (SLC_DEBUG, "Recording switches to '%s'", filename);
+}
+
+
+/** Start replaying a trace from a file */
+void sim_swtrace_replay (const char *filename)
+{
+	FILE *fp;
+	long size;
+	U8 *p;
+
+	fp = fopen (filename, "rb");
+	if (!fp)
+	{
+		simlog (SLC_DEBUG, "Cannot replay '%s'", filename);
+		sim_exit (1);
+	}
+	fseek (fp, 0, SEEK_END);
+	size = ftell (fp);
+	fseek (fp, 0, SEEK_SET);
+	swtrace_replay_data = size >= 0 ? malloc (size + 1) : NULL;
+	if (!swtrace_replay_data)
+	{
+		simlog (SLC_DEBUG, "Cannot load '%s', not replaying", filename);
+		fclose (fp);
+		return;
+	}
+	if (fread (swtrace_replay_data, 1, size, fp) != size)
+		size = 0;
+	fclose (fp);
+	swtrace_replay_data[size] = '\0';
+	swtrace_replay_end = swtrace_replay_data + size;
+
+	/* Check the header */
+	p = swtrace_replay_data;
+	if (size < 7 || memcmp (p, SWTRACE_MAGIC, 4)
+		|| p[4] != SWTRACE_VERSION || p[5] != NUM_SWITCHES
+		|| strcmp ((char *)p + 6, MACHINE_SHORTNAME))
+	{
+		simlog (SLC_DEBUG, "'%s' is not a switch trace for this machine", filename);
+		sim_exit (1);
+	}
+	swtrace_replay_pos = p + 6 + strlen (MACHINE_SHORTNAME) + 1;
+
+	swtrace_replay_begin = swtrace_replay_time = realtime_read ();
+	gettimeofday (&swtrace_replay_start, NULL);
+	sim_swtrace_replaying = 1;
+	simlog (SLC_DEBUG, "Replaying switches from '%s'", filename);
+}
+
+
+/** Called at exit to finish the recording */
+void sim_swtrace_stop (void)
+{
+	if (swtrace_record_fp)
+	{
+		fclose (swtrace_record_fp);
+		swtrace_record_fp = NULL;
+		simlog (SLC_DEBUG, "Recorded %lu switch changes", swtrace_record_count);
+	}
+}
+
+
+/** Report on a finished replay and exit */
+static void swtrace_replay_finish (void)
+{
+	struct timeval now;
+	unsigned long wall_ms;
+
+	gettimeofday (&now, NULL);
+	wall_ms = (now.tv_sec - swtrace_replay_start.tv_sec) * 1000
+		+ (now.tv_usec - swtrace_replay_start.tv_usec) / 1000;
+	simlog (SLC_DEBUG, "Replayed %lu switch changes, %lu ms in %lu ms",
+		swtrace_replay_count, realtime_read () - swtrace_replay_begin, wall_ms);
+	sim_swtrace_replaying = 0;
+	sim_exit (0);
+}
+
+
+/** Apply all replayed changes that are due */
+CALLSET_ENTRY (swtrace, realtime_tick)
+{
+	unsigned long delta;
+	U8 *mark;
+	U8 c;
+
+	if (!sim_swtrace_replaying)
+		return;
+
+	for (;;)
+	{
+		mark = swtrace_replay_pos;
+		if (!swtrace_read_varint (&delta)
+			|| swtrace_replay_pos >= swtrace_replay_end)
+		{
+			swtrace_replay_pos = mark;
+			if (realtime_read () >= swtrace_replay_time + SWTRACE_REPLAY_LINGER)
+				swtrace_replay_finish ();
+			return;
+		}
+		if (swtrace_replay_time + delta > realtime_read ())
+		{
+			swtrace_replay_pos = mark;
+			return;
+		}
+		swtrace_replay_time += delta;
+		c = *swtrace_replay_pos++;
+		sim_switch_replay (c & ~SWTRACE_LEVEL, c & SWTRACE_LEVEL);
+		swtrace_replay_count++;
+	}
+}
@@ -31,32 +31,119 @@
  * other things, so there are no guarantees.
  */
 
-#define RING_COUNT 256
+/*
+ * Timers are kept in a two-level timer wheel.  The inner wheel has one
+ * slot per tick and holds everything due within the next INNER_COUNT
+ * ticks.  The outer wheel has one slot per lap of the inner wheel.
+ * Each time the inner wheel comes back to slot 0, the outer slot for
+ * the new lap is emptied into it.  A timer due more than OUTER_COUNT
+ * laps out just goes back into the same outer slot, to be looked at
+ * again the next time around, so there is no limit on how far ahead
+ * a timer can be scheduled.  Either way, the work done on each tick
+ * does not grow with the number of timers that are not yet due.
+ */
+
+#define INNER_BITS 8
+#define INNER_COUNT (1UL << INNER_BITS)
+#define OUTER_BITS 6
+#define OUTER_COUNT (1UL << OUTER_BITS)
 
-#define ring_later(ticks) ((ring_now + (ticks)) % RING_COUNT)
+#define inner_slot(t) ((t) & (INNER_COUNT - 1))
+#define outer_slot(t) (((t) >> INNER_BITS) & (OUTER_COUNT - 1))
 
+/** The number of timer entries to allocate when the free list runs out */
+#define POOL_GROW 64
+
+
+/** A list of timers in one slot of a wheel.  The tail is kept so that
+ * entries can be appended without walking the list. */
+struct time_slot
+{
+	struct time_handler *head;
+	struct time_handler *tail;
+};
 
-/** The current time, modulo the ring count.  This is measured
- * in 1ms increments (more precisely, the number of IRQs). */
-unsigned int ring_now = 0;
+/** The current time.  This is measured in 1ms increments (more
+ * precisely, the number of IRQs). */
+unsigned long sim_ticks = 0;
 
-/** The timer ring.  Each entry contains a list of handlers to
+/** The inner wheel.  Each entry contains a list of handlers to
  * be called when the current time reaches the value indicated
  * by the position in the array. */
-struct time_handler *time_handler_ring[RING_COUNT] = { NULL, };
+struct time_slot inner_wheel[INNER_COUNT];
 
+/** The outer wheel */
+struct time_slot outer_wheel[OUTER_COUNT];
 
-/** Allocate a new timer ring entry */
-static struct time_handler *ring_malloc (void)
+/** Timer entries that are not in use */
+struct time_handler *time_handler_free = NULL;
+
+
+/** Allocate a new timer entry */
+static struct time_handler *time_handler_alloc (void)
 {
-	return malloc (sizeof (struct time_handler));
+	struct time_handler *elem;
+
+	/* Entries are never given back, so grow the pool in blocks
+	 * rather than calling malloc for each timer. */
+	if (!time_handler_free)
+	{
+		unsigned int n;
+		elem = malloc (POOL_GROW * sizeof (struct time_handler));
+		if (!elem)
+		{
+			simlog (SLC_DEBUG, "can't alloc timer");
+			exit (1);
+		}
+		for (n = 0; n < POOL_GROW; n++, elem++)
+		{
+			elem->next = time_handler_free;
+			time_handler_free = elem;
+		}
+	}
+
+	elem = time_handler_free;
+	time_handler_free = elem->next;
+	return elem;
 }
 
 
-/** Free a timer ring entry */
-static void ring_free (struct time_handler *elem)
+/** Free a timer entry */
+static void time_handler_release (struct time_handler *elem)
 {
-	free (elem);
+	elem->next = time_handler_free;
+	time_handler_free = elem;
+}
+
+
+/** Append a timer entry to the end of a slot's list */
+static void time_slot_append (struct time_slot *slot, struct time_handler *elem)
+{
+	elem->next = NULL;
+	if (slot->tail)
+		slot->tail->next = elem;
+	else
+		slot->head = elem;
+	slot->tail = elem;
+}
+
+
+/** Remove and return all of the entries in a slot */
+static struct time_handler *time_slot_take (struct time_slot *slot)
+{
+	struct time_handler *elem = slot->head;
+	slot->head = slot->tail = NULL;
+	return elem;
+}
+
+
+/** Put a timer entry into the wheel, according to when it expires */
+static void time_handler_insert (struct time_handler *elem)
+{
+	if (elem->expires - sim_ticks < INNER_COUNT)
+		time_slot_append (&inner_wheel[inner_slot (elem->expires)], elem);
+	else
+		time_slot_append (&outer_wheel[outer_slot (elem->expires)], elem);
 }
 
 
@@ -64,23 +151,21 @@ static void ring_free (struct time_handler *elem)
  * PERIOIDIC_P is nonzero if the timer function should be called repeatedly,
  * every time that much time has elapsed.
  * FN is the function to be called and DATA can be anything at all, passed to
- * the handler. */
+ * the handler.  Timers due on the same tick are called in the order that
+ * they were registered. */
 void sim_time_register (int n_ticks, int periodic_p, time_handler_t fn, void *data)
 {
-	unsigned int ring = ring_later (n_ticks);
-
-	struct time_handler *elem = ring_malloc ();
-	if (!elem)
-		simlog (SLC_DEBUG, "can't alloc ring");
+	struct time_handler *elem = time_handler_alloc ();
 
-	if (n_ticks > RING_COUNT)
-		simlog (SLC_DEBUG, "can't schedule timer that far out");
+	/* The current tick's timers may already be running */
+	if (n_ticks < 1)
+		n_ticks = 1;
 
-	elem->next = time_handler_ring[ring];
 	elem->periodicity = periodic_p ? n_ticks : 0;
+	elem->expires = sim_ticks + n_ticks;
 	elem->fn = fn;
 	elem->data = data;
-	time_handler_ring[ring] = elem;
+	time_handler_insert (elem);
 }
 
 
@@ -91,45 +176,41 @@ void sim_time_register (int n_ticks, int periodic_p, time_handler_t fn, void *da
  */
 void sim_time_step (void)
 {
-	struct time_handler *elem, *elem_next, *periodic;
+	struct time_handler *elem, *elem_next;
+
+	/* At the start of each lap of the inner wheel, move the timers
+	 * for this lap in from the outer wheel.  Those still more than
+	 * a lap away go back where they were. */
+	if (inner_slot (sim_ticks) == 0)
+	{
+		elem = time_slot_take (&outer_wheel[outer_slot (sim_ticks)]);
+		while (elem != NULL)
+		{
+			elem_next = elem->next;
+			time_handler_insert (elem);
+			elem = elem_next;
+		}
+	}
 
 	/* Atomically get and clear the list of timers to
 	 * be executed on this tick */
-	elem = time_handler_ring[ring_now];
-	time_handler_ring[ring_now] = NULL;
+	elem = time_slot_take (&inner_wheel[inner_slot (sim_ticks)]);
 
 	/* Call each timer function */
 	while (elem != NULL)
 	{
+		elem_next = elem->next;
 		(*elem->fn) (elem->data);
 
+		/* If periodic, just requeue it rather than free/alloc */
 		if (elem->periodicity)
 		{
-			/* If periodic, just requeue it rather than free/alloc */
-			elem_next = elem->next;
-
-
-			periodic = time_handler_ring[ring_later (elem->periodicity)];
-			if (!periodic)
-			{
-				time_handler_ring[ring_later (elem->periodicity)] = elem;
-			}
-			else
-			{
-				while (periodic->next != NULL)
-					periodic = periodic->next;
-				periodic->next = elem;
-			}
-			elem->next = NULL;
-			elem = elem_next;
+			elem->expires += elem->periodicity;
+			time_handler_insert (elem);
 		}
 		else
-		{
-			elem_next = elem->next;
-			ring_free (elem);
-			elem = elem_next;
-		}
+			time_handler_release (elem);
+		elem = elem_next;
 	}
-	ring_now = ring_later (1);
+	sim_ticks++;
 }
-
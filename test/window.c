@@ -577,6 +577,7 @@ struct audit standard_audits[] = {
 	{ "RIGHT FLIPPER", AUDIT_TYPE_INT, &system_audits.right_flippers },
 	{ "TROUGH RESCUE", AUDIT_TYPE_INT, &system_audits.trough_rescues },
 	{ "CHASE BALLS", AUDIT_TYPE_INT, &system_audits.chase_balls },
+	{ "SW. QUEUE OVERFLOW", AUDIT_TYPE_INT, &system_audits.switch_queue_overflows },
 	{ "LOCKUP 1 ADDR", AUDIT_TYPE_INT, &system_audits.lockup1_addr },
 	{ "LOCKUP 1 PID/LEF", AUDIT_TYPE_INT, &system_audits.lockup1_pid_lef },
 	{ NULL, AUDIT_TYPE_NONE, NULL },
@@ -1124,6 +1125,23 @@ struct deff_leff_ops dev_leff_ops = {
 };
 
 
+/** Show the display queue statistics on the bottom row */
+static void deff_queue_stats_draw (void)
+{
+	sprintf ("Q %d  OVF %ld  EXP %ld", deff_queue_count,
+		deff_queue_overflows, deff_queue_expirations);
+	font_render_string_center (&font_var5, 64, 28, sprintf_buffer);
+}
+
+
+/** Show the lamp effect queue statistics on the bottom row */
+static void leff_queue_stats_draw (void)
+{
+	sprintf ("Q %d  OVF %ld", leff_queue_count, leff_queue_overflows);
+	font_render_string_center (&font_var5, 64, 28, sprintf_buffer);
+}
+
+
 /** A thread for updating the currently running deff or leff.
 This thread polls the currently selected item and updates the
 display accordingly. */
@@ -1145,6 +1163,7 @@ void deff_leff_thread (void)
 					sprintf_far_string (names_of_deffs + menu_selection);
 					print_row_center (&font_var5, 12);
 					browser_print_operation ("STOPPED");
+					deff_queue_stats_draw ();
 				}
 			}
 			else
@@ -1156,6 +1175,7 @@ void deff_leff_thread (void)
 					browser_print_operation ("RUNNING");
 				else
 					browser_print_operation ("STOPPED");
+				leff_queue_stats_draw ();
 			}
 		}
 		deff_leff_last_active = is_active;
@@ -1272,9 +1292,18 @@ void deff_stress_thread (void)
 	}
 }
 
+/* Enter clears the display queue statistics, which are shown
+in the display effects test once the stress test is done. */
+void deff_stress_enter (void)
+{
+	sound_send (SND_TEST_CONFIRM);
+	deff_queue_stats_reset ();
+}
+
 struct window_ops deff_stress_window = {
 	DEFAULT_WINDOW,
 	.thread = deff_stress_thread,
+	.enter = deff_stress_enter,
 	.exit = deff_stop_all,
 };
 
@@ -1734,16 +1763,47 @@ void dev_frametest_init (void)
 }
 
 
-void dev_frametest_draw (void)
+/* Draw the current frame into the mapped pages.  A frame in the
+middle of a delta stream only holds the changes from the frame two
+before it, so the stream is played from the last pair of full frames
+up to this one. */
+static void dev_frametest_frame_draw (void)
 {
-	dmd_alloc_pair ();
-	if (test_frame_mode == 0)
+	U16 id;
+
+	if (!frame_delta_p (test_frameno))
 	{
+		dmd_alloc_pair ();
 		frame_draw (test_frameno);
+		return;
 	}
-	else
+
+	id = test_frameno;
+	while (id >= 2 && (frame_delta_p (id) || frame_delta_p (id - 2)))
+		id -= 2;
+	if (id >= 2)
+		id -= 2;
+
+	frame_stream_begin ();
+	for (;;)
+	{
+		frame_stream_draw (id);
+		if (id == test_frameno)
+			break;
+		id += 2;
+	}
+}
+
+
+void dev_frametest_draw (void)
+{
+	/* Both planes are always drawn, since the second may be encoded
+	relative to the first; then just one of them may be shown. */
+	dev_frametest_frame_draw ();
+	if (test_frame_mode != 0)
 	{
-		frame_draw_plane (test_frameno + test_frame_mode - 1);
+		if (test_frame_mode == 2)
+			dmd_flip_low_high ();
 		dmd_clean_page_high ();
 	}
 	dmd_show2 ();
@@ -1836,7 +1896,10 @@ void sched_test_draw (void)
 #if (MACHINE_DMD == 1)
 	sprintf ("SCHEDULES PER SEC. = %ld", sched_test_count);
 	print_row_center (&font_var5, 10);
-	font_render_string_center (&font_var5, 64, 20, "PRESS ENTER TO REPEAT");
+	sprintf ("GID LOOKUPS/TICK %ld MAX %ld",
+		task_gid_lookups_last, task_gid_lookups_max);
+	print_row_center (&font_var5, 18);
+	font_render_string_center (&font_var5, 64, 26, "PRESS ENTER TO REPEAT");
 #else
 	sprintf ("%ld SCHED./SEC.", sched_test_count);
 	print_row_center (&font_var5, 16);
@@ -1899,6 +1962,133 @@ struct menu irqload_test_item = {
 
 /**********************************************************************/
 
+#ifdef CONFIG_TASK_PROFILE
+
+/* Up/down select one profile entry at a time; the extra entry
+   after the last one shows the latency histogram.  Enter clears all of
+   the profile data. */
+
+void task_profile_test_init (void)
+{
+	browser_init ();
+	browser_max = TASK_PROFILE_SLOTS;
+}
+
+
+void task_profile_test_draw (void)
+{
+	task_profile_t *prof;
+
+	window_title ("TASK PROFILE");
+	if (menu_selection == TASK_PROFILE_SLOTS)
+	{
+		sprintf ("LAT 0-2 %ld %ld %ld", task_profile_latency[0],
+			task_profile_latency[1], task_profile_latency[2]);
+		print_row_center (&font_var5, 12);
+		sprintf ("3+ %ld %ld %ld", task_profile_latency[3],
+			task_profile_latency[4], task_profile_latency[5]);
+		print_row_center (&font_var5, 22);
+	}
+	else
+	{
+		prof = &task_profile_table[menu_selection];
+		if (menu_selection == TASK_PROFILE_SLOTS-1)
+			sprintf ("OTHER DISP %ld", prof->dispatches);
+		else
+			sprintf ("GID %d DISP %ld", prof->gid, prof->dispatches);
+		print_row_center (&font_var5, 12);
+		sprintf ("RUN %ld LAT %d", prof->run_time, prof->max_latency);
+		print_row_center (&font_var5, 22);
+	}
+	dmd_show_low ();
+}
+
+
+void task_profile_test_enter (void)
+{
+	sound_send (SND_TEST_CONFIRM);
+	task_profile_reset ();
+}
+
+
+struct window_ops task_profile_test_window = {
+	INHERIT_FROM_BROWSER,
+	.init = task_profile_test_init,
+	.draw = task_profile_test_draw,
+	.enter = task_profile_test_enter,
+};
+
+struct menu task_profile_test_item = {
+	.name = "TASK PROFILE",
+	.flags = M_ITEM,
+	.var = { .subwindow = { &task_profile_test_window, NULL } },
+};
+
+#endif /* CONFIG_TASK_PROFILE */
+
+/**********************************************************************/
+
+#ifdef CONFIG_SWITCH_LATENCY
+
+/* Up/down select one switch/coil pair at a time.  Times are in
+   milliseconds.  Enter clears all of the data. */
+
+void switch_latency_test_init (void)
+{
+	browser_init ();
+	browser_max = SWITCH_LATENCY_PAIRS-1;
+}
+
+
+void switch_latency_test_draw (void)
+{
+	const switch_latency_pair_t *pair = &switch_latency_table[menu_selection];
+
+	window_title ("SWITCH LATENCY");
+	if (pair->sw == SWITCH_LATENCY_NONE)
+	{
+		sprintf ("NO DATA");
+		print_row_center (&font_var5, 12);
+		sprintf ("DROPPED %ld", switch_latency_dropped);
+		print_row_center (&font_var5, 22);
+	}
+	else
+	{
+		sprintf ("SW %d SOL %d N %ld", pair->sw, pair->sol, pair->count);
+		print_row_center (&font_var5, 12);
+		sprintf ("%ld/%ld/%ld P99 %ld", pair->min,
+			switch_latency_average (pair), pair->max,
+			switch_latency_p99 (pair));
+		print_row_center (&font_var5, 22);
+	}
+	dmd_show_low ();
+}
+
+
+void switch_latency_test_enter (void)
+{
+	sound_send (SND_TEST_CONFIRM);
+	switch_latency_reset ();
+}
+
+
+struct window_ops switch_latency_test_window = {
+	INHERIT_FROM_BROWSER,
+	.init = switch_latency_test_init,
+	.draw = switch_latency_test_draw,
+	.enter = switch_latency_test_enter,
+};
+
+struct menu switch_latency_test_item = {
+	.name = "SWITCH LATENCY",
+	.flags = M_ITEM,
+	.var = { .subwindow = { &switch_latency_test_window, NULL } },
+};
+
+#endif /* CONFIG_SWITCH_LATENCY */
+
+/**********************************************************************/
+
 #define SCORE_TEST_PLAYERS 4
 
 const score_t score_test_increment = { 0x00, 0x01, 0x23, 0x45, 0x60 };
@@ -2151,6 +2341,12 @@ struct menu *dev_menu_items[] = {
 	&sched_test_item,
 #ifndef CONFIG_NATIVE
 	&irqload_test_item,
+#endif
+#ifdef CONFIG_TASK_PROFILE
+	&task_profile_test_item,
+#endif
+#ifdef CONFIG_SWITCH_LATENCY
+	&switch_latency_test_item,
 #endif
 	&score_test_item,
 #if (MACHINE_PIC == 1)
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * A minimal stand-in for <freewpc.h>, so that a font source file can be
+ * compiled into the host-side fontshift tool.  Only what the font files
+ * themselves use is declared here.  The font_t layout must match
+ * include/system/font.h.
+ */
+
+#ifndef _FONTSHIFT_FREEWPC_H
+#define _FONTSHIFT_FREEWPC_H
+
+typedef unsigned char U8;
+
+typedef struct font
+{
+	U8 spacing;
+	U8 height;
+	char **glyphs;
+	U8 basechar;
+} font_t;
+
+#endif /* _FONTSHIFT_FREEWPC_H */
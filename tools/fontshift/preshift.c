@@ -0,0 +1,123 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * preshift - emit pre-shifted glyph data for one font.
+ *
+ * This program is not built on its own.  The fontshift script compiles
+ * it once per font, with FONT_SOURCE giving the path to the font's source
+ * file, FONT_FILE its name for comments, and FONT_IDENT the name of its
+ * font_t (without the font_ prefix).  When
+ * run, it writes C code for the glyphs in FONT_PRESHIFT_CHARS, shifted
+ * right by each of 0 to 7 bits, plus a table of pointers to them
+ * covering FONT_PRESHIFT_FIRST through FONT_PRESHIFT_LAST.
+ *
+ * Each pre-shifted glyph is the number of bytes per row, followed by
+ * the rows.  Pixels are stored LSB first, as on the display.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <freewpc.h>
+#include FONT_SOURCE
+
+/* Keep these in sync with include/system/font.h */
+#define FONT_PRESHIFT_FIRST ','
+#define FONT_PRESHIFT_LAST ':'
+
+#define FONT_PRESHIFT_CHARS "0123456789,."
+
+#define XFONT_DECL(id) font_ ## id
+#define FONT_DECL(id) XFONT_DECL(id)
+#define XSTR(s) #s
+#define STR(s) XSTR(s)
+
+static const char *ident = STR(FONT_IDENT);
+
+
+static const unsigned char *glyph_data (const font_t *font, char c)
+{
+	if (c < font->basechar)
+		return NULL;
+	return (const unsigned char *)font->glyphs[c - font->basechar];
+}
+
+
+static void emit_shifted (const unsigned char *data, char c, unsigned int shift)
+{
+	unsigned int width = data[0];
+	unsigned int height = data[1];
+	unsigned int in_bytes = (width + 7) / 8;
+	unsigned int out_bytes = (width + shift + 7) / 8;
+	unsigned int row, n;
+	const unsigned char *src = data + 2;
+
+	printf ("static const U8 preshift_%s_%d_%u[] = {\n\t%u,",
+		ident, c, shift, out_bytes);
+	for (row = 0; row < height; row++)
+	{
+		unsigned long bits = 0;
+		for (n = 0; n < in_bytes; n++)
+			bits |= (unsigned long)src[n] << (n * 8);
+		bits <<= shift;
+		src += in_bytes;
+
+		printf ("\n\t");
+		for (n = 0; n < out_bytes; n++)
+			printf ("0x%02lX,", (bits >> (n * 8)) & 0xFF);
+	}
+	printf ("\n};\n");
+}
+
+
+int main (void)
+{
+	const font_t *font = &FONT_DECL(FONT_IDENT);
+	const unsigned char *data;
+	unsigned int shift;
+	char c;
+
+	printf ("/* Pre-shifted glyphs for font_%s, from %s */\n\n",
+		ident, FONT_FILE);
+
+	for (c = FONT_PRESHIFT_FIRST; c <= FONT_PRESHIFT_LAST; c++)
+	{
+		if (!strchr (FONT_PRESHIFT_CHARS, c) || !(data = glyph_data (font, c)))
+			continue;
+		for (shift = 0; shift < 8; shift++)
+			emit_shifted (data, c, shift);
+	}
+
+	printf ("static const U8 *const preshift_%s_glyphs[] = {\n", ident);
+	for (c = FONT_PRESHIFT_FIRST; c <= FONT_PRESHIFT_LAST; c++)
+	{
+		printf ("\t/* '%c' */", c);
+		for (shift = 0; shift < 8; shift++)
+		{
+			if (strchr (FONT_PRESHIFT_CHARS, c) && glyph_data (font, c))
+				printf (" preshift_%s_%d_%u,", ident, c, shift);
+			else
+				printf (" NULL,");
+		}
+		printf ("\n");
+	}
+	printf ("};\n\n");
+	return 0;
+}
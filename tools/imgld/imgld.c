@@ -41,14 +41,23 @@
  * will be downscaled to 4 colors as necessary.
  *
  * The pinball game ROM may implement a number of decoders; at present,
- * there are two supported decoders.  One does simple run-length encoding
+ * there are four supported decoders.  One does simple run-length encoding
  * of 16-bit words.  It is written for very easy decoding with little
  * runtime overhead, and so does not compress very well.  However,
  * CPU cycles are considered more precious than ROM space.  The second
- * is for sparse images with lots of zeroes.  Different codecs may be
- * added in the future with different properties; e.g. for a long-
- * running animation when the CPU is mostly idle may need to tuned
- * for better compression at the cost of a longer decompression time.
+ * is for sparse images with lots of zeroes.  The third applies only to
+ * the second plane of an image, and stores just the words where it
+ * differs from the first plane.  The fourth uses back-references to
+ * earlier bytes of the frame; it compresses best but is the slowest
+ * to decode.  tools/imglib/codec_bench compares them over a set of
+ * images.
+ *
+ * Full-screen animations can be marked as a delta stream, by putting
+ * a line '%delta' before the frames and '%end' after.  Each frame in
+ * the stream after the first two may then be stored as just its
+ * differences from the frame two before it, which is what is still
+ * on the display page that it will be drawn into.  Such a stream must
+ * be played in order with frame_stream_draw(), not frame_draw().
  *
  * Command-line parameters specify the total amount of space that is
  * allocated for images.  The linker should only compress as is
@@ -84,6 +93,7 @@ do { \
 #define OPT_FAST   0x2
 
 #define TYPE_BITMAP 0x80
+#define TYPE_DELTA 0xA
 
 
 enum image_format {
@@ -131,12 +141,28 @@ struct frame
 	 * considered for further compression.
 	 */
 	int already_scanned;
+
+	/*
+	 * For the second plane of an image, the first plane.  The game
+	 * draws that plane first, so this one can be encoded against it.
+	 */
+	struct frame *ref;
+
+	/*
+	 * In a delta stream, the same plane of the image two frames
+	 * earlier.  The game decodes this frame on top of it.
+	 */
+	struct frame *prev;
 };
 
 /** The master list of all frames */
 unsigned int frame_count = 0;
 struct frame frame_array[MAX_FRAMES];
 
+/** The index of the first frame in the current delta stream, or -1
+when not in a stream */
+int stream_first = -1;
+
 /** The file handle for writing the imagemap.h */
 FILE *lblfile;
 
@@ -249,15 +275,57 @@ unsigned int frame_length_with_header (struct buffer *buf)
 
 
 /**
- * A list of encoding functions.  Each takes an uncompressed joined
- * bitmap, 512 bytes in length, and returns a new buffer that contains
- * the encoded version.  This list is sorted so that the preferred
- * encoders are listed first.
+ * A list of encoding functions.  Each takes a frame, whose raw buffer
+ * is an uncompressed joined bitmap 512 bytes in length, and returns a
+ * new buffer that contains the encoded version.  An encoder which
+ * needs a reference frame that this frame does not have returns NULL.
+ * This list is sorted so that the preferred encoders are listed first;
+ * they are the ones fastest to decode.
  */
-typedef struct buffer *(*encoder_t) (struct buffer *);
+typedef struct buffer *(*encoder_t) (struct frame *);
+
+static struct buffer *rle_encoder (struct frame *frame)
+{
+	return buffer_rle_encode (frame->rawbuf);
+}
+
+static struct buffer *sparse_encoder (struct frame *frame)
+{
+	return buffer_sparse_encode (frame->rawbuf);
+}
+
+static struct buffer *xor_encoder (struct frame *frame)
+{
+	if (!frame->ref)
+		return NULL;
+	return buffer_xor_encode (frame->rawbuf, frame->ref->rawbuf);
+}
+
+/* A delta uses the same block format as the plane XOR, but is
+applied to the page as it is rather than to a copy of the first
+plane. */
+static struct buffer *delta_encoder (struct frame *frame)
+{
+	struct buffer *buf;
+
+	if (!frame->prev)
+		return NULL;
+	buf = buffer_xor_encode (frame->rawbuf, frame->prev->rawbuf);
+	buf->type = TYPE_DELTA;
+	return buf;
+}
+
+static struct buffer *lz_encoder (struct frame *frame)
+{
+	return buffer_lz_encode (frame->rawbuf);
+}
+
 encoder_t encoder_list[] = {
-	buffer_rle_encode,
-	buffer_sparse_encode,
+	rle_encoder,
+	sparse_encoder,
+	xor_encoder,
+	delta_encoder,
+	lz_encoder,
 };
 
 
@@ -312,7 +380,9 @@ void compress_frames (void)
 		if compression fails in all cases */
 		for (i=0; i < sizeof (encoder_list) / sizeof (encoder_t); i++)
 		{
-			newbuf = encoder_list[i] (aframe->rawbuf);
+			newbuf = encoder_list[i] (aframe);
+			if (newbuf == NULL)
+				continue;
 			if (newbuf->len < aframe->curbuf->len)
 			{
 				/* This method is better than all previous ones.
@@ -360,53 +430,20 @@ void add_frame (const char *label, struct buffer *buf)
 	frame->name = NULL;
 	frame->cost = 0;
 	frame->already_scanned = 0;
+	frame->ref = NULL;
+	frame->prev = NULL;
 	frame_count++;
 }
 
 
-/**
- * Return the Nth plane of a PGM image.
- */
-struct buffer *pgm_get_plane (struct buffer *buf, unsigned int plane)
-{
-	unsigned int level, off;
-	struct buffer *planebuf;
-
-	planebuf = buffer_clone (buf);
-
-	for (off = 0; off < planebuf->len; off++)
-	{
-		/* Each byte in the image contains an intensity value ranging from
-		0 to 255.  For FreeWPC images, these need to be scaled down
-		to one of 4 levels (0-3). */
-		if (buf->data[off] <= 25 * 0xFF / 100)
-			level = 0;
-		else if (buf->data[off] <= 50 * 0xFF / 100)
-			level = 1;
-		else if (buf->data[off] <= 75 * 0xFF / 100)
-			level = 2;
-		else
-			level = 3;
-
-		/* Set the data byte to a '1' if the level is enabled in this plane,
-		or '0' otherwise. */
-		planebuf->data[off] = (level & (1 << plane)) ? 1 : 0;
-	}
-
-	/* Convert to a joined buffer, in which the bits are tightly compressed,
-	8 pixels to 1 byte */
-	planebuf = buffer_replace (planebuf, buffer_joinbits (planebuf));
-	return planebuf;
-}
-
-
 /**
  * Add a new image file to the frame list.
  */
 void add_image (const char *label, const char *filename, unsigned int options)
 {
 	FILE *imgfile;
-	struct buffer *buf;
+	struct buffer *buf, *delta;
+	struct frame *frame;
 	int plane;
 	enum image_format format;
 
@@ -444,6 +481,29 @@ void add_image (const char *label, const char *filename, unsigned int options)
 		if ((buf->width < 128) || (buf->height < 32))
 			planebuf->type |= TYPE_BITMAP;
 		add_frame (!plane ? label : NULL, planebuf);
+		if (planebuf->type & TYPE_BITMAP)
+			continue;
+
+		frame = &frame_array[frame_count-1];
+		if (plane)
+			frame->ref = frame - 1;
+
+		/* Within a delta stream, frames are always stored as deltas
+		when that is smaller, since they are also faster to draw. */
+		if (stream_first >= 0 && frame_count - 1 >= stream_first + 4)
+		{
+			frame->prev = frame - 4;
+			if (frame->prev->rawbuf->type & TYPE_BITMAP)
+				error ("%s: delta streams can only hold full-sized frames", filename);
+			delta = delta_encoder (frame);
+			if (delta->len < frame->curbuf->len)
+			{
+				delta->type |= planebuf->type;
+				frame->curbuf = delta;
+			}
+			else
+				buffer_free (delta);
+		}
 	}
 
 	/* Free the original image buffer */
@@ -560,6 +620,14 @@ void parse_config (const char *filename)
 		{
 			if (*word == '#')
 				break;
+			else if (!strcmp (word, "%delta"))
+			{
+				if (stream_first >= 0)
+					error ("delta streams cannot be nested");
+				stream_first = frame_count;
+			}
+			else if (!strcmp (word, "%end"))
+				stream_first = -1;
 			else if (strchr (word, ':'))
 				label = word;
 			else if (*word == '!')
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * \file
+ * \brief Compare the frame codecs over a set of PGM images.
+ *
+ * Each 128x32 image is split into its two planes, which are encoded
+ * in every format that imgld knows about.  Each encoding is decoded
+ * again and checked against the original.  The size and an estimate
+ * of the 6809 cycles needed to decode it are printed for each plane;
+ * the smallest encoding is marked with '*' and the fastest with '+'.
+ *
+ * The cycle counts come from walking the encoded data with the cost
+ * of each step of the decoders in platform/wpc/dmd.s.  They ignore
+ * the fixed overhead of frame_draw and so are only useful to compare
+ * one codec against another.
+ */
+
+#include "imglib.h"
+
+enum codec {
+	CODEC_RAW, CODEC_RLE, CODEC_SPARSE, CODEC_XOR, CODEC_LZ, NUM_CODECS
+};
+
+const char *codec_names[NUM_CODECS] = {
+	"raw", "rle", "sparse", "xor", "lz"
+};
+
+/** Cost of copying a whole plane, as dmd_copy_page does */
+#define RAW_CYCLES 3136
+
+unsigned long total_size[NUM_CODECS];
+unsigned long total_cycles[NUM_CODECS];
+unsigned long best_size_total;
+unsigned long best_cycles_total;
+unsigned int planes;
+
+
+unsigned long rle_cycles (struct buffer *enc)
+{
+	const U8 *p = enc->data;
+	unsigned long cycles = 0;
+
+	for (;;)
+	{
+		if (p[0] != 0xA8)
+		{
+			cycles += 21;
+			p += 2;
+		}
+		else if (p[1] & 0x80)
+			break;
+		else if (p[1] == 0)
+		{
+			cycles += 30;
+			p += 3;
+		}
+		else
+		{
+			cycles += 37 + 17 * p[1];
+			p += 3;
+		}
+	}
+	return cycles;
+}
+
+
+unsigned long sparse_cycles (struct buffer *enc)
+{
+	const U8 *p = enc->data;
+	unsigned long cycles = 950; /* for dmd_clean_page */
+
+	while (*p != 0)
+	{
+		cycles += 24 + 25 * p[0];
+		p += 2 + p[0] * 2;
+	}
+	return cycles;
+}
+
+
+unsigned long lz_cycles (struct buffer *enc)
+{
+	const U8 *p = enc->data;
+	unsigned long cycles = 0;
+
+	while (*p != 0)
+	{
+		cycles += 12;
+		if (*p & 0x80)
+		{
+			cycles += 28 + 21 * ((*p & 0x7F) + 3);
+			p += 2;
+		}
+		else
+		{
+			cycles += 16 * *p;
+			p += 1 + *p;
+		}
+	}
+	return cycles;
+}
+
+
+unsigned long xor_cycles (struct buffer *enc)
+{
+	const U8 *p = enc->data;
+	unsigned long cycles = RAW_CYCLES; /* for dmd_copy_page */
+
+	while (p[0] != 0 || p[1] != 0)
+	{
+		cycles += 20 + 34 * p[0];
+		p += 2 + p[0] * 2;
+	}
+	return cycles;
+}
+
+
+void bench_plane (const char *name, int plane,
+	struct buffer *buf, struct buffer *ref)
+{
+	struct buffer *enc, *dec;
+	unsigned long size[NUM_CODECS], cycles[NUM_CODECS];
+	int codec, best_size, best_cycles;
+
+	best_size = best_cycles = CODEC_RAW;
+	for (codec = 0; codec < NUM_CODECS; codec++)
+	{
+		switch (codec)
+		{
+			case CODEC_RAW:
+				enc = buffer_copy (buf);
+				dec = buffer_copy (buf);
+				cycles[codec] = RAW_CYCLES;
+				break;
+			case CODEC_RLE:
+				enc = buffer_rle_encode (buf);
+				dec = buffer_rle_decode (enc);
+				cycles[codec] = rle_cycles (enc);
+				break;
+			case CODEC_SPARSE:
+				enc = buffer_sparse_encode (buf);
+				dec = buffer_sparse_decode (enc);
+				cycles[codec] = sparse_cycles (enc);
+				break;
+			case CODEC_XOR:
+				if (!ref)
+				{
+					size[codec] = cycles[codec] = 0;
+					continue;
+				}
+				enc = buffer_xor_encode (buf, ref);
+				dec = buffer_xor_decode (enc, ref);
+				cycles[codec] = xor_cycles (enc);
+				break;
+			case CODEC_LZ:
+			default:
+				enc = buffer_lz_encode (buf);
+				dec = buffer_lz_decode (enc);
+				cycles[codec] = lz_cycles (enc);
+				break;
+		}
+
+		if (buffer_compare (buf, dec))
+		{
+			fprintf (stderr, "%s: plane %d: %s codec does not round-trip\n",
+				name, plane, codec_names[codec]);
+			exit (1);
+		}
+
+		size[codec] = enc->len;
+		if (size[codec] < size[best_size])
+			best_size = codec;
+		if (cycles[codec] < cycles[best_cycles])
+			best_cycles = codec;
+		total_size[codec] += size[codec];
+		total_cycles[codec] += cycles[codec];
+		buffer_free (enc);
+		buffer_free (dec);
+	}
+
+	/* Without a reference, count the best choice instead so that
+	the xor totals can be compared with the others. */
+	if (!ref)
+	{
+		total_size[CODEC_XOR] += size[best_size];
+		total_cycles[CODEC_XOR] += cycles[best_cycles];
+	}
+
+	best_size_total += size[best_size];
+	best_cycles_total += cycles[best_cycles];
+	planes++;
+
+	printf ("%-32.32s %d", name, plane);
+	for (codec = 0; codec < NUM_CODECS; codec++)
+	{
+		if (codec == CODEC_XOR && !ref)
+			printf ("  %13s", "-");
+		else
+			printf ("  %4lu/%-6lu%c%c", size[codec], cycles[codec],
+				codec == best_size ? '*' : ' ',
+				codec == best_cycles ? '+' : ' ');
+	}
+	printf ("\n");
+}
+
+
+void bench_file (const char *filename)
+{
+	FILE *fp;
+	struct buffer *buf, *plane0, *plane1;
+	const char *name;
+
+	fp = fopen (filename, "r");
+	if (!fp)
+	{
+		perror (filename);
+		exit (1);
+	}
+	buf = buffer_alloc (MAX_BUFFER_SIZE);
+	buffer_read_pgm (buf, fp);
+	fclose (fp);
+
+	/* Smaller images are stored as bitmaps and never compressed */
+	if (buf->width != FRAME_WIDTH || buf->height != FRAME_HEIGHT)
+	{
+		buffer_free (buf);
+		return;
+	}
+
+	name = strrchr (filename, '/');
+	name = name ? name + 1 : filename;
+
+	plane0 = pgm_get_plane (buf, 0);
+	plane1 = pgm_get_plane (buf, 1);
+	bench_plane (name, 0, plane0, NULL);
+	bench_plane (name, 1, plane1, plane0);
+	buffer_free (plane0);
+	buffer_free (plane1);
+	buffer_free (buf);
+}
+
+
+int main (int argc, char *argv[])
+{
+	int argn, codec;
+
+	if (argc < 2)
+	{
+		fprintf (stderr, "usage: codec_bench file.pgm...\n");
+		exit (1);
+	}
+
+	printf ("%-32s %s", "image", "p");
+	for (codec = 0; codec < NUM_CODECS; codec++)
+		printf ("  %-13s", codec_names[codec]);
+	printf ("\n");
+
+	for (argn = 1; argn < argc; argn++)
+		bench_file (argv[argn]);
+
+	if (planes == 0)
+		exit (0);
+
+	printf ("\n%u planes, bytes/cycles per plane:\n", planes);
+	for (codec = 0; codec < NUM_CODECS; codec++)
+		printf ("%-8s %6lu %8lu\n", codec_names[codec],
+			total_size[codec] / planes, total_cycles[codec] / planes);
+	printf ("%-8s %6lu %8lu\n", "best",
+		best_size_total / planes, best_cycles_total / planes);
+	exit (0);
+}
@@ -308,6 +308,42 @@ void buffer_write_pgm (struct buffer *buf, FILE *fp)
 }
 
 
+/**
+ * Return the Nth plane of a PGM image.
+ */
+struct buffer *pgm_get_plane (struct buffer *buf, unsigned int plane)
+{
+	unsigned int level, off;
+	struct buffer *planebuf;
+
+	planebuf = buffer_clone (buf);
+
+	for (off = 0; off < planebuf->len; off++)
+	{
+		/* Each byte in the image contains an intensity value ranging from
+		0 to 255.  For FreeWPC images, these need to be scaled down
+		to one of 4 levels (0-3). */
+		if (buf->data[off] <= 25 * 0xFF / 100)
+			level = 0;
+		else if (buf->data[off] <= 50 * 0xFF / 100)
+			level = 1;
+		else if (buf->data[off] <= 75 * 0xFF / 100)
+			level = 2;
+		else
+			level = 3;
+
+		/* Set the data byte to a '1' if the level is enabled in this plane,
+		or '0' otherwise. */
+		planebuf->data[off] = (level & (1 << plane)) ? 1 : 0;
+	}
+
+	/* Convert to a joined buffer, in which the bits are tightly compressed,
+	8 pixels to 1 byte */
+	planebuf = buffer_replace (planebuf, buffer_joinbits (planebuf));
+	return planebuf;
+}
+
+
 void cdecl_begin (const char ident[], FILE *fp)
 {
 	fprintf (fp, "unsigned char %s[] = {", ident);
@@ -812,9 +848,11 @@ struct buffer *buffer_rle_encode (struct buffer *buf)
 		}
 		else
 		{
-			/* See how many following bytes are the same */
+			/* See how many following bytes are the same.  A run cannot
+			exceed 127 words, since a negative count ends the frame. */
 			int run = 0;
-			while ((srcp + run < buf->data + 512) && (srcp[run] == b))
+			while ((srcp + run < buf->data + 512) && (srcp[run] == b)
+				&& run < 253)
 				run++;
 			/* Include the current byte in the count, too */
 			run++;
@@ -847,14 +885,49 @@ struct buffer *buffer_rle_encode (struct buffer *buf)
 }
 
 
+/**
+ * Decode a buffer produced by buffer_rle_encode().
+ * This mirrors frame_decode_rle in the game ROM.
+ */
 struct buffer *buffer_rle_decode (struct buffer *buf)
 {
 	struct buffer *res;
+	U8 *srcp = buf->data;
+	U8 *dstp;
+	U8 words, val;
 
 	res = buffer_alloc (512);
-	/* TODO */
 	res->width = buf->width;
 	res->height = buf->height;
+	dstp = res->data;
+
+	while (dstp < res->data + 512)
+	{
+		if (srcp[0] != 0xA8)
+		{
+			*dstp++ = *srcp++;
+			*dstp++ = *srcp++;
+		}
+		else if (srcp[1] & 0x80)
+			break;
+		else if (srcp[1] == 0)
+		{
+			*dstp++ = 0xA8;
+			*dstp++ = srcp[2];
+			srcp += 3;
+		}
+		else
+		{
+			words = srcp[1];
+			val = srcp[2];
+			srcp += 3;
+			while (words-- > 0 && dstp < res->data + 512)
+			{
+				*dstp++ = val;
+				*dstp++ = val;
+			}
+		}
+	}
 	return res;
 }
 
@@ -889,14 +962,29 @@ struct buffer *buffer_sparse_encode (struct buffer *buf)
 			srcp++;
 		}
 
-		/* See how many following bytes are zero.
-		 * Don't strip them from the input yet. */
+		/* See how many following bytes are nonzero.
+		 * Don't strip them from the input yet.  A block holds at
+		 * most 255 words. */
 		count = 0;
-		while (srcp[count] != 0 && srcp + count < buf->data + 512)
+		while (srcp + count < buf->data + 512 && srcp[count] != 0
+			&& count < 509)
 		{
 			count++;
 		}
 
+		/* A zero count would end the frame, so if the skip limit was
+		 * reached in the middle of a run of zeroes, emit one word of
+		 * them as literal data. */
+		if (count == 0 && srcp < buf->data + 512)
+		{
+			count = 2;
+			if (srcp + count > buf->data + 512)
+			{
+				zeroes--;
+				srcp--;
+			}
+		}
+
 		/* The size of each literal block needs to be word aligned.
 		 * If not, add a zero back in, preferably from the amount
 		 * just skipped, otherwise from the following data. */
@@ -928,6 +1016,229 @@ struct buffer *buffer_sparse_encode (struct buffer *buf)
 	return res;
 }
 
+
+/**
+ * Decode a buffer produced by buffer_sparse_encode().
+ */
+struct buffer *buffer_sparse_decode (struct buffer *buf)
+{
+	struct buffer *res;
+	U8 *srcp = buf->data;
+	U8 *dstp;
+	U8 words;
+
+	res = buffer_alloc (512);
+	res->width = buf->width;
+	res->height = buf->height;
+	dstp = res->data;
+
+	while ((words = *srcp++) != 0)
+	{
+		dstp += *srcp++;
+		memcpy (dstp, srcp, words * 2);
+		dstp += words * 2;
+		srcp += words * 2;
+	}
+	return res;
+}
+
+
+/**
+ * Encode a joined bitmap using back-references (type 6).
+ *
+ * The output is a series of tokens.  A token byte of 0x01-0x7F is
+ * followed by that many literal bytes.  A token of 0x80-0xFF means
+ * that (token & 0x7F) + 3 bytes are copied from earlier in the frame;
+ * the next byte gives how far back, 1-255 bytes.  An offset of 16 is
+ * the row above, and an offset shorter than the length repeats a
+ * pattern, so this also covers what RLE does.  A zero token ends
+ * the frame.
+ */
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (0x7F + LZ_MIN_MATCH)
+#define LZ_MAX_OFFSET 255
+#define LZ_MAX_LITERALS 0x7F
+
+struct buffer *buffer_lz_encode (struct buffer *buf)
+{
+	struct buffer *res;
+	U8 *dstp;
+	U8 *literals = NULL;
+	unsigned int pos, off, len;
+	unsigned int best_len, best_off;
+
+	res = buffer_clone (buf);
+	dstp = res->data;
+
+	for (pos = 0; pos < 512; )
+	{
+		/* Find the longest match within the window */
+		best_len = best_off = 0;
+		for (off = 1; off <= LZ_MAX_OFFSET && off <= pos; off++)
+		{
+			for (len = 0; pos + len < 512 && len < LZ_MAX_MATCH; len++)
+				if (buf->data[pos + len] != buf->data[pos + len - off])
+					break;
+			if (len > best_len)
+			{
+				best_len = len;
+				best_off = off;
+			}
+		}
+
+		if (best_len >= LZ_MIN_MATCH)
+		{
+			*dstp++ = 0x80 | (best_len - LZ_MIN_MATCH);
+			*dstp++ = best_off;
+			literals = NULL;
+			pos += best_len;
+		}
+		else
+		{
+			/* Extend the current literal run, or start a new one */
+			if (literals == NULL || *literals == LZ_MAX_LITERALS)
+			{
+				literals = dstp++;
+				*literals = 0;
+			}
+			(*literals)++;
+			*dstp++ = buf->data[pos++];
+		}
+	}
+
+	*dstp++ = 0;
+	res->len = dstp - res->data;
+	res->type |= 0x6;
+	return res;
+}
+
+
+/**
+ * Decode a buffer produced by buffer_lz_encode().
+ */
+struct buffer *buffer_lz_decode (struct buffer *buf)
+{
+	struct buffer *res;
+	U8 *srcp = buf->data;
+	U8 *dstp;
+	U8 token, len, off;
+
+	res = buffer_alloc (512);
+	res->width = buf->width;
+	res->height = buf->height;
+	dstp = res->data;
+
+	while ((token = *srcp++) != 0)
+	{
+		if (token & 0x80)
+		{
+			len = (token & 0x7F) + LZ_MIN_MATCH;
+			off = *srcp++;
+			do {
+				*dstp = dstp[-off];
+				dstp++;
+			} while (--len > 0);
+		}
+		else
+		{
+			memcpy (dstp, srcp, token);
+			dstp += token;
+			srcp += token;
+		}
+	}
+	return res;
+}
+
+
+/**
+ * Encode the second plane of a 4-color image relative to the
+ * first plane, REF (type 8).
+ *
+ * The decoder starts from a copy of the first plane, so only the
+ * 16-bit words that differ are stored, XORed with the first plane.
+ * Each block is a word count, a byte count to skip over, and then
+ * the words.  A block with no words just skips; one that neither
+ * skips nor has words ends the frame.  When both planes are the
+ * same, as for images that only use black and full brightness,
+ * this is just the two-byte terminator.
+ */
+struct buffer *buffer_xor_encode (struct buffer *buf, struct buffer *ref)
+{
+	struct buffer *res;
+	U8 *dstp;
+	unsigned int pos, skip, words;
+
+	res = buffer_clone (buf);
+	dstp = res->data;
+
+#define XOR_WORD_ZERO(p) \
+	(buf->data[p] == ref->data[p] && buf->data[(p)+1] == ref->data[(p)+1])
+
+	for (pos = 0; pos < 512; )
+	{
+		for (skip = 0; pos < 512 && skip < 254 && XOR_WORD_ZERO (pos); skip += 2)
+			pos += 2;
+
+		for (words = 0; pos + words * 2 < 512 && words < 255; words++)
+			if (XOR_WORD_ZERO (pos + words * 2))
+				break;
+
+		/* Nothing is left to change */
+		if (words == 0 && pos >= 512)
+			break;
+
+		*dstp++ = words;
+		*dstp++ = skip;
+		while (words-- > 0)
+		{
+			*dstp++ = buf->data[pos] ^ ref->data[pos];
+			pos++;
+			*dstp++ = buf->data[pos] ^ ref->data[pos];
+			pos++;
+		}
+	}
+#undef XOR_WORD_ZERO
+
+	*dstp++ = 0;
+	*dstp++ = 0;
+	res->len = dstp - res->data;
+	res->type |= 0x8;
+	return res;
+}
+
+
+/**
+ * Decode a buffer produced by buffer_xor_encode(), given the
+ * first plane REF.
+ */
+struct buffer *buffer_xor_decode (struct buffer *buf, struct buffer *ref)
+{
+	struct buffer *res;
+	U8 *srcp = buf->data;
+	U8 *dstp;
+	U8 words, skip;
+
+	res = buffer_copy (ref);
+	res->width = buf->width;
+	res->height = buf->height;
+	dstp = res->data;
+
+	for (;;)
+	{
+		words = *srcp++;
+		skip = *srcp++;
+		if (words == 0 && skip == 0)
+			break;
+		dstp += skip;
+		while (words-- > 0)
+		{
+			*dstp++ ^= *srcp++;
+			*dstp++ ^= *srcp++;
+		}
+	}
+	return res;
+}
+
 /********************************************************************/
 
 
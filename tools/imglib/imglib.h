@@ -114,6 +114,7 @@ char enhanced_pixel_ascii (unsigned int pixel);
 void bitmap_write_ascii(struct buffer *buf, FILE *fp);
 void buffer_read_pgm(struct buffer *buf, FILE *fp);
 void buffer_write_pgm(struct buffer *buf, FILE *fp);
+struct buffer *pgm_get_plane (struct buffer *buf, unsigned int plane);
 void buffer_write_c(struct buffer *buf, FILE *fp);
 void cdecl_begin(const char ident[], FILE *fp);
 void cdecl_end(FILE *fp);
@@ -131,7 +132,13 @@ struct img_histogram *histogram_update(struct buffer *buf);
 struct buffer *buffer_compress(struct buffer *buf, struct buffer *prev);
 struct buffer *buffer_decompress(struct buffer *buf);
 struct buffer *buffer_rle_encode (struct buffer *buf);
+struct buffer *buffer_rle_decode (struct buffer *buf);
 struct buffer *buffer_sparse_encode (struct buffer *buf);
+struct buffer *buffer_sparse_decode (struct buffer *buf);
+struct buffer *buffer_lz_encode (struct buffer *buf);
+struct buffer *buffer_lz_decode (struct buffer *buf);
+struct buffer *buffer_xor_encode (struct buffer *buf, struct buffer *ref);
+struct buffer *buffer_xor_decode (struct buffer *buf, struct buffer *ref);
 struct buffer *bitmap_crop(struct buffer *buf);
 void bitmap_draw_pixel(struct buffer *buf, unsigned int x, unsigned int y);
 void bitmap_draw_line(struct buffer *buf, int x1, int y1, int x2, int y2);
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * This file is part of FreeWPC.
+ *
+ * FreeWPC is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FreeWPC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FreeWPC; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* This program converts a binary signal capture, written by the
+simulator after 'capture format binary', into the text format that
+it writes otherwise: a line per millisecond with the time and the
+value of each signal.  The binary format is described in sim/signal.c. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define MAX_CAPTURES 16
+
+#define SIGCAP_VERSION 1
+#define SIGCAP_DOUBLE 0x20
+#define SIGCAP_TYPE_MASK 0xF0
+#define SIGCAP_COL_MASK 0x0F
+#define SIGCAP_END 0xFF
+
+FILE *in, *out;
+
+unsigned int n_signals;
+
+double values[MAX_CAPTURES];
+
+
+void error (const char *msg)
+{
+	fprintf (stderr, "sigconv: %s\n", msg);
+	exit (1);
+}
+
+
+int get_u8 (void)
+{
+	int c = getc (in);
+	if (c == EOF)
+		error ("unexpected end of file");
+	return c;
+}
+
+
+uint64_t get_uint (int bytes)
+{
+	uint64_t val = 0;
+	int n;
+	for (n = 0; n < bytes; n++)
+		val |= (uint64_t)get_u8 () << (n * 8);
+	return val;
+}
+
+
+uint64_t get_varint (void)
+{
+	uint64_t val = 0;
+	int shift = 0;
+	int c;
+	do {
+		c = get_u8 ();
+		val |= (uint64_t)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	return val;
+}
+
+
+/** Write a text line for each time from FROM up to, but not
+including, UNTIL, with the current values. */
+void write_lines (uint64_t from, uint64_t until)
+{
+	unsigned int n;
+	for (; from < until; from++)
+	{
+		fprintf (out, "%lu", (unsigned long)from);
+		for (n = 0; n < n_signals; n++)
+			fprintf (out, " %g", values[n]);
+		fprintf (out, "\n");
+	}
+}
+
+
+/** Convert one segment of the capture, after its magic number */
+void convert_segment (void)
+{
+	unsigned int n, count;
+	uint64_t now, next;
+	int c;
+
+	if (get_u8 () != SIGCAP_VERSION)
+		error ("unsupported version");
+	n_signals = get_u8 ();
+	if (n_signals > MAX_CAPTURES)
+		error ("too many signals");
+
+	fprintf (out, "# Time");
+	for (n = 0; n < n_signals; n++)
+		fprintf (out, " %u", (unsigned int)get_uint (4));
+	fprintf (out, "\n");
+
+	now = get_uint (8);
+	for (n = 0; n < n_signals; n++)
+		values[n] = 0.0;
+
+	for (;;)
+	{
+		/* A capture which was never stopped just ends */
+		c = getc (in);
+		if (c == EOF)
+		{
+			write_lines (now, now + 1);
+			return;
+		}
+		ungetc (c, in);
+
+		next = now + get_varint ();
+		write_lines (now, next);
+		now = next;
+
+		count = get_u8 ();
+		if (count == SIGCAP_END)
+		{
+			write_lines (now, now + 1);
+			return;
+		}
+
+		while (count-- > 0)
+		{
+			int tag = get_u8 ();
+			unsigned int col = tag & SIGCAP_COL_MASK;
+			if (col >= n_signals)
+				error ("bad column");
+			if ((tag & SIGCAP_TYPE_MASK) == SIGCAP_DOUBLE)
+			{
+				uint64_t bits = get_uint (8);
+				memcpy (&values[col], &bits, sizeof (double));
+			}
+			else
+				values[col] = (tag & SIGCAP_TYPE_MASK) ? 1.0 : 0.0;
+		}
+	}
+}
+
+
+int main (int argc, char *argv[])
+{
+	char magic[4];
+
+	if (argc < 2 || argc > 3)
+	{
+		fprintf (stderr, "usage: sigconv <binary-capture> [<text-output>]\n");
+		exit (1);
+	}
+
+	in = fopen (argv[1], "rb");
+	if (!in)
+		error ("can't open input file");
+	out = (argc == 3) ? fopen (argv[2], "w") : stdout;
+	if (!out)
+		error ("can't open output file");
+
+	while (fread (magic, sizeof (magic), 1, in) == 1)
+	{
+		if (memcmp (magic, "FWSG", sizeof (magic)))
+			error ("not a binary signal capture");
+		convert_segment ();
+	}
+
+	fclose (in);
+	if (out != stdout)
+		fclose (out);
+	exit (0);
+}